@@ -44,6 +44,18 @@ namespace graphchi {
         virtual size_t num_tasks() = 0;
         virtual void new_iteration(int iteration) = 0;
         virtual void remove_tasks(vid_t fromvertex, vid_t tovertex) = 0;
+        
+        /**
+         * Returns true if any vertex in [fromvertex, tovertex] is
+         * scheduled. Schedulers should override this if they can
+         * answer without checking each vertex.
+         */
+        virtual bool is_any_scheduled(vid_t fromvertex, vid_t tovertex) {
+            for(vid_t v=fromvertex; v <= tovertex; v++) {
+                if (is_scheduled(v)) return true;
+            }
+            return false;
+        }
     };
     
     
@@ -62,6 +74,7 @@ namespace graphchi {
         }
         virtual void add_task_to_all() { }
         virtual bool is_scheduled(vid_t vertex) { return true; }
+        virtual bool is_any_scheduled(vid_t fromvertex, vid_t tovertex) { return true; }
         virtual size_t num_tasks() { return 0; }
         virtual void new_iteration(int iteration) {} 
         
@@ -0,0 +1,267 @@
+/**
+ * @file
+ * @author  Aapo Kyrola <akyrola@cs.cmu.edu>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * Copyright [2012] [Aapo Kyrola, Guy Blelloch, Carlos Guestrin / Carnegie Mellon University]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+
+ *
+ * @section DESCRIPTION
+ *
+ * Bitset scheduler that can be used without locks (define
+ * ATOMIC_SCHEDULER). Tasks may be added concurrently by update
+ * functions and by a thread that streams new edges, also while
+ * the scheduler grows.
+ *
+ * The bits are kept in chunks of 2^SCHEDULER_CHUNK_BITS vertices
+ * that are allocated as the scheduler grows and never move, so
+ * growing does not realloc under threads that set bits. Bits are
+ * set with a fetch-or on their 64-bit word (only if not already
+ * set), and has_new_tasks is a relaxed atomic flag.
+ *
+ * new_iteration() must not run concurrently with add_task(); the
+ * engine calls it between iterations.
+ */
+
+#ifndef ATOMIC_SCHEDULER
+ ERROR(ATOMIC_SCHEDULER NEEDS TO BE DEFINED)
+#endif
+
+#ifndef DEF_GRAPHCHI_BITSETSCHEDULER
+#define DEF_GRAPHCHI_BITSETSCHEDULER
+
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+
+#include "graphchi_types.hpp"
+#include "api/ischeduler.hpp"
+#include "util/dense_bitset.hpp"
+#include "util/pthread_tools.hpp"
+
+#ifndef SCHEDULER_CHUNK_BITS
+#define SCHEDULER_CHUNK_BITS 20
+#endif
+
+namespace graphchi {
+
+    /**
+     * Flag that is read and written with relaxed atomics. Reads and
+     * writes look like those of a bool.
+     */
+    struct relaxed_flag {
+        std::atomic<bool> value;
+
+        relaxed_flag() : value(false) {}
+
+        inline operator bool() const {
+            return value.load(std::memory_order_relaxed);
+        }
+
+        inline relaxed_flag & operator=(bool b) {
+            value.store(b, std::memory_order_relaxed);
+            return *this;
+        }
+    };
+
+    /**
+     * Bitset made of fixed-size dense_bitset chunks. A chunk is
+     * allocated (under a lock) the first time it is needed and
+     * published atomically; after that, it is used without locks.
+     */
+    class chunked_bitset {
+        static const size_t chunkbits = size_t(1) << SCHEDULER_CHUNK_BITS;
+        static const size_t maxchunks = ((size_t(1) << (8 * sizeof(vid_t))) + chunkbits - 1) / chunkbits;
+
+        dense_bitset * chunks[maxchunks];
+        size_t len;
+        mutex growlock;
+
+        inline dense_bitset * chunk(size_t c) const {
+            return __atomic_load_n(&chunks[c], __ATOMIC_ACQUIRE);
+        }
+
+        dense_bitset * chunk_for_write(size_t c) {
+            dense_bitset * d = chunk(c);
+            if (d == NULL) {
+                growlock.lock();
+                d = chunks[c];
+                if (d == NULL) {
+                    d = new dense_bitset(chunkbits);
+                    __atomic_store_n(&chunks[c], d, __ATOMIC_RELEASE);
+                }
+                growlock.unlock();
+            }
+            return d;
+        }
+
+    public:
+        chunked_bitset(size_t n) : len(0) {
+            memset(chunks, 0, sizeof(chunks));
+            resize(n);
+        }
+
+        ~chunked_bitset() {
+            for(size_t c=0; c < maxchunks; c++) {
+                if (chunks[c] != NULL) delete chunks[c];
+            }
+        }
+
+        /**
+         * Allocates the chunks for n bits. Chunks are not released when
+         * the bitset shrinks.
+         */
+        void resize(size_t n) {
+            size_t nchunks = (n + chunkbits - 1) / chunkbits;
+            for(size_t c=0; c < nchunks; c++) {
+                chunk_for_write(c);
+            }
+            growlock.lock();
+            len = n;
+            growlock.unlock();
+        }
+
+        inline size_t size() const {
+            return len;
+        }
+
+        inline bool get(vid_t b) const {
+            dense_bitset * d = chunk(b >> SCHEDULER_CHUNK_BITS);
+            return d != NULL && d->get(b & (chunkbits - 1));
+        }
+
+        //! Set the bit returning the old value
+        inline bool set_bit(vid_t b) {
+            dense_bitset * d = chunk_for_write(b >> SCHEDULER_CHUNK_BITS);
+            uint32_t bit = b & (chunkbits - 1);
+            if (d->get(bit)) return true;  // Avoid writing to the word if we can
+            return d->set_bit(bit);
+        }
+
+        inline void clear_bits(vid_t fromb, vid_t tob) { // tob is inclusive
+            for(size_t c = fromb >> SCHEDULER_CHUNK_BITS; c <= (tob >> SCHEDULER_CHUNK_BITS); c++) {
+                dense_bitset * d = chunk(c);
+                if (d == NULL) continue;
+                size_t st = c * chunkbits;
+                d->clear_bits((uint32_t) (std::max(size_t(fromb), st) - st),
+                              (uint32_t) (std::min(size_t(tob), st + chunkbits - 1) - st));
+            }
+        }
+
+        inline bool any(vid_t fromb, vid_t tob) const { // tob is inclusive
+            for(size_t c = fromb >> SCHEDULER_CHUNK_BITS; c <= (tob >> SCHEDULER_CHUNK_BITS); c++) {
+                dense_bitset * d = chunk(c);
+                if (d == NULL) continue;
+                size_t st = c * chunkbits;
+                if (d->any((uint32_t) (std::max(size_t(fromb), st) - st),
+                           (uint32_t) (std::min(size_t(tob), st + chunkbits - 1) - st))) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void clear() {
+            for(size_t c=0; c < maxchunks; c++) {
+                if (chunks[c] != NULL) chunks[c]->clear();
+            }
+        }
+
+        void setall() {
+            for(size_t c=0; c < maxchunks; c++) {
+                if (chunks[c] != NULL) chunks[c]->setall();
+            }
+        }
+    };
+
+    class bitset_scheduler : public ischeduler {
+    private:
+        chunked_bitset * curiteration_bitset;
+        chunked_bitset * nextiteration_bitset;
+    public:
+        relaxed_flag has_new_tasks;
+
+        bitset_scheduler(int nvertices) {
+            curiteration_bitset = new chunked_bitset(nvertices);
+            nextiteration_bitset = new chunked_bitset(nvertices);
+        }
+
+        void new_iteration(int iteration) {
+            if (iteration > 0) {
+                // Swap
+                chunked_bitset * tmp = curiteration_bitset;
+                curiteration_bitset = nextiteration_bitset;
+                nextiteration_bitset = tmp;
+                nextiteration_bitset->clear();
+            }
+
+        }
+
+        virtual ~bitset_scheduler() {
+            delete nextiteration_bitset;
+            delete curiteration_bitset;
+        }
+
+        inline void add_task(vid_t vertex, bool also_this_iteration=false) {
+            nextiteration_bitset->set_bit(vertex);
+            if (also_this_iteration) {
+                // If possible, add to schedule already this iteration
+                curiteration_bitset->set_bit(vertex);
+            }
+            if (!has_new_tasks) has_new_tasks = true;
+        }
+
+        void resize(vid_t maxsize) {
+            curiteration_bitset->resize(maxsize);
+            nextiteration_bitset->resize(maxsize);
+
+        }
+
+        inline bool is_scheduled(vid_t vertex) {
+            return curiteration_bitset->get(vertex);
+        }
+
+        bool is_any_scheduled(vid_t fromvertex, vid_t tovertex) {
+            if (fromvertex > tovertex) return false;
+            return curiteration_bitset->any(fromvertex, tovertex);
+        }
+
+        void remove_tasks(vid_t fromvertex, vid_t tovertex) {
+            nextiteration_bitset->clear_bits(fromvertex, tovertex);
+        }
+
+
+
+        void add_task_to_all() {
+            has_new_tasks = true;
+            curiteration_bitset->setall();
+        }
+
+        size_t num_tasks() {
+            size_t n = 0;
+            for(vid_t i=0; i < curiteration_bitset->size(); i++) {
+                n += curiteration_bitset->get(i);
+            }
+            return n;
+        }
+
+    };
+
+}
+
+
+#endif
@@ -30,6 +30,7 @@
 #ifndef DEF_GRAPHCHI_DEGREE_DATA
 #define DEF_GRAPHCHI_DEGREE_DATA
 
+#include <algorithm>
 #include <fstream>
 #include <assert.h>
 #include <string>
@@ -69,6 +70,10 @@ namespace graphchi {
         bool use_mmap;
         degree * mmap_file;
         size_t mmap_length;
+        
+        /* Number of vertices, and the number the file has room for */
+        size_t nvertices;
+        size_t capacity;
      
         virtual void open_file(std::string base_filename) {
             filename = filename_degree_data(base_filename);
@@ -97,6 +102,7 @@ namespace graphchi {
                 logstream(LOG_INFO) << "Use memory mapping for degree data." << std::endl;
             }
             open_file(base_filename);
+            nvertices = capacity = get_filesize(filename) / sizeof(degree);
         }
         
         virtual ~degree_data() {
@@ -104,12 +110,19 @@ namespace graphchi {
                 if (loaded_chunk != NULL) {
                     iomgr->managed_release(filedesc, &loaded_chunk);
                 }        
+                /* Drop the room we did not use */
+                if (capacity > nvertices) {
+                    iomgr->truncate(filedesc, nvertices * sizeof(degree));
+                }
                 iomgr->close_session(filedesc);
             } else {
                 if (modified) {
                     msync(mmap_file, mmap_length, MS_SYNC);
                 }
                 munmap(mmap_file, mmap_length);
+                if (capacity > nvertices) {
+                    ftruncate(filedesc, nvertices * sizeof(degree));
+                }
                 close(filedesc);
             }
         }
@@ -188,12 +201,20 @@ namespace graphchi {
             }
         }
         
+        /**
+          * Makes room for degrees of vertices up to maxid. The file grows
+          * geometrically, so that growing it one vertex at a time is
+          * amortized O(1); the room we do not use is dropped when closing.
+          */
         void ensure_size(vid_t maxid) {
+            nvertices = std::max(nvertices, size_t(maxid) + 1);
+            if (nvertices <= capacity) return;
+            capacity = std::max(nvertices, 2 * capacity);
             if (!use_mmap) {
-                iomgr->truncate(filedesc, (1 + maxid) * sizeof(degree));
+                iomgr->truncate(filedesc, capacity * sizeof(degree));
             } else {
                 munmap(mmap_file, mmap_length);
-                ftruncate(filedesc, (1 + maxid) * sizeof(degree));
+                ftruncate(filedesc, capacity * sizeof(degree));
                 close(filedesc);
                 open_file(base_filename);
             }
@@ -37,6 +37,7 @@
 #ifndef DEF_GRAPHCHI_VERTEXDATA
 #define DEF_GRAPHCHI_VERTEXDATA
 
+#include <algorithm>
 #include <stdlib.h>
 #include <string>
 #include <assert.h>
@@ -70,6 +71,7 @@ namespace graphchi {
         size_t mmap_length;
         
         vid_t last_nvertices;
+        size_t capacity; /* Number of vertices the file has room for */
         
 
         virtual void open_file() {
@@ -91,6 +93,7 @@ namespace graphchi {
             
             mmap_file = NULL;
             last_nvertices = 0;
+            capacity = 0;
             use_mmap = get_option_int("mmap", 0);  // Whether to mmap the degree file to memory
             if (use_mmap) {
                 logstream(LOG_INFO) << "Use memory mapping for vertex data." << std::endl;
@@ -115,13 +118,26 @@ namespace graphchi {
                 munmap(mmap_file, mmap_length);
                 close(filedesc);
             }
+            /* Drop the room we did not use */
+            if (capacity > last_nvertices) {
+                checkarray_filesize<VertexDataType>(filename, last_nvertices);
+            }
         }
         
-        
+        /**
+         * Sets the number of vertices. Shrinking truncates the file
+         * exactly, as clear() relies on the room past the last vertex
+         * being zero.
+         */
         void check_size(size_t nvertices) {
             if (nvertices == last_nvertices) return;
+            if (nvertices > last_nvertices && nvertices <= capacity) {
+                last_nvertices = nvertices;
+                return;
+            }
+            size_t newcapacity = (nvertices > last_nvertices ? std::max(nvertices, 2 * capacity) : nvertices);
             if (!use_mmap) {
-                checkarray_filesize<VertexDataType>(filename, nvertices);
+                checkarray_filesize<VertexDataType>(filename, newcapacity);
             } else {
                 if (mmap_file) {
                     msync(mmap_file, mmap_length, MS_SYNC);
@@ -129,9 +145,10 @@ namespace graphchi {
                     mmap_file = NULL;
                     close(filedesc);
                 }
-                checkarray_filesize<VertexDataType>(filename, nvertices);
+                checkarray_filesize<VertexDataType>(filename, newcapacity);
                 open_file();
             }
+            capacity = newcapacity;
             last_nvertices = nvertices;
         }
         
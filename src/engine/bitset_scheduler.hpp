@@ -26,9 +26,15 @@
  * Bitset scheduler.
  */
 
+#ifdef ATOMIC_SCHEDULER
+#include "engine/atomic_bitset_scheduler.hpp"
+#else
+
 #ifndef DEF_GRAPHCHI_BITSETSCHEDULER
 #define DEF_GRAPHCHI_BITSETSCHEDULER
 
+#include <algorithm>
+
 #include "graphchi_types.hpp"
 #include "api/ischeduler.hpp"
 #include "util/dense_bitset.hpp"
@@ -82,6 +88,17 @@ namespace graphchi {
             return curiteration_bitset->get(vertex);
         }
         
+        /**
+         * Uses the summary of the bitset, so intervals with
+         * no scheduled vertices are skipped cheaply.
+         */
+        bool is_any_scheduled(vid_t fromvertex, vid_t tovertex) {
+            if (curiteration_bitset->size() == 0) return false;
+            vid_t last = (vid_t) (curiteration_bitset->size() - 1);
+            if (fromvertex > last) return false;
+            return curiteration_bitset->any(fromvertex, std::min(tovertex, last));
+        }
+        
         void remove_tasks(vid_t fromvertex, vid_t tovertex) {
             nextiteration_bitset->clear_bits(fromvertex, tovertex);
         }
@@ -107,4 +124,4 @@ namespace graphchi {
 
 
 #endif
-
+#endif
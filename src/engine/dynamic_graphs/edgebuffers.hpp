@@ -30,6 +30,7 @@
 #define DEF_GRAPHCHI_EDGEBUFFERS
 
 #include <stdlib.h>
+#include <algorithm>
 #include <vector> 
 
 
@@ -52,15 +53,42 @@ namespace graphchi {
     
 #define EDGE_BUFFER_CHUNKSIZE 65536
     
+    /**
+     * Entry of an edge_buffer_flat index: an edge's source (or destination)
+     * and its position in the buffer.
+     */
+    struct edge_buffer_key {
+        vid_t vid;
+        unsigned int idx;
+        
+        bool operator<(const edge_buffer_key &other) const {
+            return vid < other.vid || (vid == other.vid && idx < other.idx);
+        }
+    };
+    
+    static inline bool edge_buffer_key_below(const edge_buffer_key &key, vid_t vid) {
+        return key.vid < vid;
+    }
+    
+    static inline bool edge_buffer_key_above(vid_t vid, const edge_buffer_key &key) {
+        return vid < key.vid;
+    }
+    
     /**
      * Efficient chunked edge-buffer with very low memory-overhead (compared
      * to just using a std-vector.
+     * Edges can be looked up by a range of sources or destinations: the
+     * buffer keeps an index of its edges sorted by source and one sorted by
+     * destination. An index is brought up to date only when it is used, by
+     * sorting the edges added since and merging them in.
      */
     template <typename ET>
     class edge_buffer_flat {
         
         unsigned int count;
         std::vector<created_edge<ET> *> bufs;
+        std::vector<edge_buffer_key> by_src;
+        std::vector<edge_buffer_key> by_dst;
         
     public:    
         
@@ -76,6 +104,8 @@ namespace graphchi {
                 free(bufs[i]);
             }   
             bufs.clear();       
+            by_src.clear();
+            by_dst.clear();
             count = 0;
         }
         
@@ -100,7 +130,49 @@ namespace graphchi {
             bufs[bufidx][idx % EDGE_BUFFER_CHUNKSIZE] = cedge;
         }
         
+        /**
+         * Set [begin, end) to the index entries of the edges whose source
+         * is in [st, en], in order of source. Edges with the same source
+         * are in the order they were added. Valid until the next add().
+         */
+        void src_range(vid_t st, vid_t en, const edge_buffer_key * &begin, const edge_buffer_key * &end) {
+            update_index(by_src, true);
+            range(by_src, st, en, begin, end);
+        }
+        
+        /**
+         * As src_range(), for destinations.
+         */
+        void dst_range(vid_t st, vid_t en, const edge_buffer_key * &begin, const edge_buffer_key * &end) {
+            update_index(by_dst, false);
+            range(by_dst, st, en, begin, end);
+        }
+        
     private:
+        void update_index(std::vector<edge_buffer_key> &index, bool src) {
+            size_t indexed = index.size();
+            if (indexed == count) return;
+            for(unsigned int i=(unsigned int)indexed; i < count; i++) {
+                created_edge<ET> * edge = (*this)[i];
+                edge_buffer_key key;
+                key.vid = (src ? edge->src : edge->dst);
+                key.idx = i;
+                index.push_back(key);
+            }
+            std::sort(index.begin() + indexed, index.end());
+            std::inplace_merge(index.begin(), index.begin() + indexed, index.end());
+        }
+        
+        void range(std::vector<edge_buffer_key> &index, vid_t st, vid_t en, const edge_buffer_key * &begin, const edge_buffer_key * &end) {
+            begin = end = NULL;
+            if (index.empty()) return;
+            const edge_buffer_key * first = &index[0];
+            const edge_buffer_key * last = first + index.size();
+            begin = std::lower_bound(first, last, st, edge_buffer_key_below);
+            end = std::upper_bound(begin, last, en, edge_buffer_key_above);
+        }
+        
+
         // Disable value copying
         edge_buffer_flat(const edge_buffer_flat&);
         edge_buffer_flat& operator=(const edge_buffer_flat&);
@@ -57,6 +57,13 @@ namespace graphchi {
             added_edges = 0;
             last_commit = 0;
             maxshardsize = 200 * 1024 * 1024;
+            commit_maxwindow = (vid_t) get_option_int("commit_maxwindow", 4000000);
+            threshold_commit = get_option_string("commit_policy", "full") == "threshold";
+            commit_ratio = get_option_float("commit_ratio", 0.25);
+            if (get_option_string("commit_policy", "full") != "full" && !threshold_commit) {
+                logstream(LOG_ERROR) << "Unknown commit_policy: " << get_option_string("commit_policy") << ". Use full or threshold." << std::endl;
+                assert(false);
+            }
         }
         
     protected:
@@ -74,6 +81,24 @@ namespace graphchi {
         size_t added_edges;
         std::string state;
         size_t maxshardsize;
+        vid_t commit_maxwindow; // Vertices read at a time when rewriting a shard
+        
+        /**
+         * Commit policy. By default ("full") every shard with enough
+         * buffered edges is rewritten on commit. With the threshold
+         * policy ("threshold") a shard is rewritten only when its buffered
+         * edges are also at least commit_ratio of its edges; the other
+         * shards keep their edges in the edge buffers (they are read
+         * through incorporate_buffered_edges()). If too many edges would
+         * stay buffered, shards are rewritten in order of their ratio
+         * until at most half of max_edge_buffer remains.
+         * This only defers whole-shard rewrites: there are no on-disk
+         * delta shards, so when the graph is much larger than the edge
+         * buffer, shards are rewritten at almost every commit, as with
+         * the full policy.
+         */
+        bool threshold_commit;
+        double commit_ratio;
         size_t edges_in_shards;
         size_t orig_edges;
         
@@ -83,6 +108,19 @@ namespace graphchi {
         mutex schedulerlock;
         mutex shardlock;
         
+        /**
+         * Producers blocked in add_edge() / add_edges() wait on ingest_cond
+         * (see wait_for_buffer_space()).
+         */
+        mutex ingest_lock;
+        conditional ingest_cond;
+        
+        /**
+         * Scratch space of add_edges() (used under the modification lock).
+         */
+        std::vector<int> batch_buckets;
+        std::vector<size_t> batch_order;
+        
         /** 
          * Preloading will interfere with the operation.
          */
@@ -125,7 +163,9 @@ namespace graphchi {
         
     protected:
         void init_buffers() {
-            max_edge_buffer = get_option_long("max_edgebuffer_mb", 1000) * 1024 * 1024 / sizeof(created_edge<EdgeDataType>);
+            // Each buffered edge also has an entry in the source and destination indices
+            max_edge_buffer = get_option_long("max_edgebuffer_mb", 1000) * 1024 * 1024 /
+                (sizeof(created_edge<EdgeDataType>) + 2 * sizeof(edge_buffer_key));
             
             // Save old so if there are existing edges, they can be moved
             std::vector< std::vector< edge_buffer * > > tmp_new_edge_buffers;
@@ -285,22 +325,62 @@ namespace graphchi {
             return this->nshards - 1; // Last shard
         }
         
+        /**
+         * Edges can be added once the first iteration has passed, and
+         * while less than 120% of max_edge_buffer edges are buffered.
+         */
+        bool can_add_edges() {
+            return this->iter >= 1 && added_edges - last_commit <= 1.2 * max_edge_buffer;
+        }
+        
+        /**
+         * Block until edges can be added. The engine wakes us up when an
+         * iteration starts and when commit_graph_changes() drains the
+         * buffers. Time spent waiting is recorded in metrics
+         * (ingest_stall_first_iteration and ingest_stall_buffer_full).
+         */
+        void wait_for_buffer_space() {
+            if (can_add_edges()) return;
+            ingest_lock.lock();
+            if (!can_add_edges()) {
+                std::string key;
+                if (this->iter < 1) {
+                    logstream(LOG_WARNING) << "Tried to add edge before first iteration has passed" << std::endl;
+                    key = "ingest_stall_first_iteration";
+                } else {
+                    logstream(LOG_INFO) << "Over 20% of max buffer... hold on...." << std::endl;
+                    key = "ingest_stall_buffer_full";
+                }
+                metrics_entry me = this->m.start_time();
+                while (!can_add_edges()) {
+                    ingest_cond.wait(ingest_lock);
+                }
+                this->m.stop_time(me, key);
+                this->m.add("ingest_stalls", 1, INTEGER);
+            }
+            ingest_lock.unlock();
+        }
+        
+        /**
+         * Wake up producers waiting in wait_for_buffer_space().
+         */
+        void wake_producers() {
+            ingest_lock.lock();
+            ingest_cond.broadcast();
+            ingest_lock.unlock();
+        }
+        
     public:       
+        /**
+         * Add an edge. Blocks until the edge can be added (see
+         * wait_for_buffer_space()). Returns true.
+         */
         bool add_edge(vid_t src, vid_t dst, EdgeDataType edata) {
             if (src == dst) {
                 logstream(LOG_WARNING) << "WARNING : tried to add self-edge!" << std::endl;
                 return true;
             }
-            if (this->iter < 1) {
-                logstream(LOG_WARNING) << "Tried to add edge before first iteration has passed" << std::endl;
-                usleep(1000000);
-                return false;
-            }
-            if (added_edges - last_commit > 1.2 * max_edge_buffer) {
-                logstream(LOG_INFO) << "Over 20% of max buffer... hold on...." << std::endl;
-                usleep(1000000); // Sleep 1 sec
-                return false;
-            }
+            wait_for_buffer_space();
             this->modification_lock.lock();
             added_edges++;
             int shard = get_shard_for(dst);
@@ -331,11 +411,96 @@ namespace graphchi {
             return true;
         }
         
+        /**
+         * Add a batch of edges. Unlike calling add_edge() for each edge,
+         * this takes the modification lock once, grows the degree data and
+         * the scheduler once (to the maximum vertex id of the batch), and adds
+         * the edges bucket by bucket (edges of a bucket keep their order).
+         * Self-edges are skipped. Blocks until the edges can be added (as
+         * add_edge() does). Returns true.
+         */
+        bool add_edges(const created_edge<EdgeDataType> * edges, size_t n) {
+            wait_for_buffer_space();
+            this->modification_lock.lock();
+            /* Bucket the edges by (shard, srcshard) with a counting sort */
+            int nbuckets = this->nshards * this->nshards;
+            std::vector<size_t> counts(nbuckets + 1, 0);
+            batch_buckets.resize(n);
+            vid_t batch_max_id = max_vertex_id;
+            for(size_t i=0; i < n; i++) {
+                if (edges[i].src == edges[i].dst) {
+                    logstream(LOG_WARNING) << "WARNING : tried to add self-edge!" << std::endl;
+                    batch_buckets[i] = -1;
+                    continue;
+                }
+                batch_buckets[i] = get_shard_for(edges[i].dst) * this->nshards + get_shard_for(edges[i].src);
+                counts[batch_buckets[i] + 1]++;
+                batch_max_id = std::max(batch_max_id, std::max(edges[i].src, edges[i].dst));
+            }
+            for(int b=0; b < nbuckets; b++) {
+                counts[b + 1] += counts[b];
+            }
+            batch_order.resize(counts[nbuckets]);
+            for(size_t i=0; i < n; i++) {
+                if (batch_buckets[i] >= 0) batch_order[counts[batch_buckets[i]]++] = i;
+            }
+            
+            /* Maintain max vertex id; extend degree and vertex data files once */
+            if (batch_max_id > max_vertex_id) {
+                max_vertex_id = batch_max_id;
+#ifdef DEBUG
+                logstream(LOG_DEBUG) << "Current Max Vertex ID is: " << max_vertex_id << std::endl;
+#endif
+                this->degree_handler->ensure_size(this->max_vertex_id); // Expand the file
+                if (this->scheduler != NULL) {
+                    schedulerlock.lock();
+                    this->scheduler->resize(1 + max_vertex_id);
+                    schedulerlock.unlock();
+                }
+            }
+            
+            // Add edges to buffers
+            for(size_t k=0; k < batch_order.size(); k++) {
+                const created_edge<EdgeDataType> & e = edges[batch_order[k]];
+                int bucket = batch_buckets[batch_order[k]];
+                new_edge_buffers[bucket / this->nshards][bucket % this->nshards]->add(e.src, e.dst, e.data);
+            }
+            added_edges += batch_order.size();
+            this->modification_lock.unlock();
+            return true;
+        }
+        
+        /**
+         * Schedule a vertex. With ATOMIC_SCHEDULER, the scheduler is
+         * safe for concurrent callers, so we do not take the lock.
+         */
         void add_task(vid_t vid) {
             if (this->scheduler != NULL) {
+#ifndef ATOMIC_SCHEDULER
                 this->modification_lock.lock();
+#endif
                 this->scheduler->add_task(vid);                
+#ifndef ATOMIC_SCHEDULER
                 this->modification_lock.unlock();
+#endif
+            }
+        }
+        
+        /**
+         * Schedule a batch of vertices, taking the modification lock once
+         * (not at all with ATOMIC_SCHEDULER).
+         */
+        void add_tasks(const vid_t * vids, size_t n) {
+            if (this->scheduler != NULL) {
+#ifndef ATOMIC_SCHEDULER
+                this->modification_lock.lock();
+#endif
+                for(size_t i=0; i < n; i++) {
+                    this->scheduler->add_task(vids[i]);
+                }
+#ifndef ATOMIC_SCHEDULER
+                this->modification_lock.unlock();
+#endif
             }
         }
        
@@ -343,32 +508,30 @@ namespace graphchi {
         void incorporate_buffered_edges(int window, vid_t window_st, vid_t window_en, std::vector<svertex_t> & vertices) {
             // Lock acquired
             int ncreated = 0;
-            // First outedges
+            // First outedges (only edges with source in the window)
             for(int shard=0; shard<this->nshards; shard++) {
                 edge_buffer &buffer_for_window = *new_edge_buffers[shard][window];
-                for(unsigned int ebi=0; ebi<buffer_for_window.size(); ebi++) {
-                    created_edge<EdgeDataType> * edge = buffer_for_window[ebi];
-                    if (edge->src >= window_st && edge->src <= window_en) {
-                        if (vertices[edge->src-window_st].scheduled) {
-                            if (vertices[edge->src-window_st].scheduled)
-                                vertices[edge->src-window_st].add_outedge(edge->dst, &edge->data, false);
-                            ncreated++;
-                        }
+                const edge_buffer_key * it, * end;
+                buffer_for_window.src_range(window_st, window_en, it, end);
+                for(; it != end; ++it) {
+                    created_edge<EdgeDataType> * edge = buffer_for_window[it->idx];
+                    if (vertices[edge->src-window_st].scheduled) {
+                        vertices[edge->src-window_st].add_outedge(edge->dst, &edge->data, false);
+                        ncreated++;
                     }
                 }
             }
             
-            // Then inedges
+            // Then inedges (only edges with destination in the window)
             for(int w=0; w<this->nshards; w++) {
                 edge_buffer &buffer_for_window = *new_edge_buffers[window][w];
-                for(unsigned int ebi=0; ebi<buffer_for_window.size(); ebi++) {
-                    created_edge<EdgeDataType> * edge = buffer_for_window[ebi];
-                    if (edge->dst >= window_st && edge->dst <= window_en) {
-                        if (vertices[edge->dst - window_st].scheduled) {
-                            if (vertices[edge->dst-window_st].scheduled)
-                                vertices[edge->dst - window_st].add_inedge(edge->src, &edge->data, false);
-                            ncreated++;
-                        }
+                const edge_buffer_key * it, * end;
+                buffer_for_window.dst_range(window_st, window_en, it, end);
+                for(; it != end; ++it) {
+                    created_edge<EdgeDataType> * edge = buffer_for_window[it->idx];
+                    if (vertices[edge->dst - window_st].scheduled) {
+                        vertices[edge->dst - window_st].add_inedge(edge->src, &edge->data, false);
+                        ncreated++;
                     }
                 }
             }
@@ -380,17 +543,17 @@ namespace graphchi {
             // First outedges
             for(int shard=0; shard < this->nshards; shard++) {
                 edge_buffer &buffer_for_window = *new_edge_buffers[shard][window];
-                for(unsigned int ebi=0; ebi<buffer_for_window.size(); ebi++) {
-                    created_edge<EdgeDataType> * edge = buffer_for_window[ebi];
-                    if (edge->src >= window_st && edge->src <= window_en) {
-                        if (!edge->accounted_for_outc) {
-                            degree d = this->degree_handler->get_degree(edge->src);
-                            d.outdegree++;
-                            this->degree_handler->set_degree(edge->src, d);
-                            
-                            modified = true;
-                            edge->accounted_for_outc = true;
-                        }
+                const edge_buffer_key * it, * end;
+                buffer_for_window.src_range(window_st, window_en, it, end);
+                for(; it != end; ++it) {
+                    created_edge<EdgeDataType> * edge = buffer_for_window[it->idx];
+                    if (!edge->accounted_for_outc) {
+                        degree d = this->degree_handler->get_degree(edge->src);
+                        d.outdegree++;
+                        this->degree_handler->set_degree(edge->src, d);
+                        
+                        modified = true;
+                        edge->accounted_for_outc = true;
                     }
                 }
             }
@@ -398,16 +561,16 @@ namespace graphchi {
             // Then inedges
             for(int w=0; w < this->nshards; w++) {
                 edge_buffer &buffer_for_window = *new_edge_buffers[window][w];
-                for(unsigned int ebi=0; ebi<buffer_for_window.size(); ebi++) {
-                    created_edge<EdgeDataType> * edge = buffer_for_window[ebi];
-                    if (edge->dst >= window_st && edge->dst <= window_en) {
-                        if (!edge->accounted_for_inc) {
-                            degree d = this->degree_handler->get_degree(edge->dst);
-                            d.indegree++;
-                            this->degree_handler->set_degree(edge->dst, d);                            
-                            edge->accounted_for_inc = true;
-                            modified = true;
-                        }
+                const edge_buffer_key * it, * end;
+                buffer_for_window.dst_range(window_st, window_en, it, end);
+                for(; it != end; ++it) {
+                    created_edge<EdgeDataType> * edge = buffer_for_window[it->idx];
+                    if (!edge->accounted_for_inc) {
+                        degree d = this->degree_handler->get_degree(edge->dst);
+                        d.indegree++;
+                        this->degree_handler->set_degree(edge->dst, d);                            
+                        edge->accounted_for_inc = true;
+                        modified = true;
                     }
                 }
             }
@@ -437,6 +600,50 @@ namespace graphchi {
 #endif
         }
         
+        /**
+         * Degrees of buffered edges are incorporated when their window
+         * is loaded, so we do that also for a skipped interval. Only the
+         * vertices with unaccounted buffered edges have their degrees
+         * loaded.
+         */
+        virtual void skip_interval(int interval, vid_t interval_st, vid_t interval_en) {
+            vid_t lo = interval_en, hi = interval_st;
+            for(int shard=0; shard < this->nshards; shard++) {
+                edge_buffer &buffer_for_window = *new_edge_buffers[shard][interval];
+                const edge_buffer_key * it, * end;
+                buffer_for_window.src_range(interval_st, interval_en, it, end);
+                for(; it != end; ++it) {
+                    created_edge<EdgeDataType> * edge = buffer_for_window[it->idx];
+                    if (!edge->accounted_for_outc) {
+                        lo = std::min(lo, edge->src);
+                        hi = std::max(hi, edge->src);
+                    }
+                }
+            }
+            for(int w=0; w < this->nshards; w++) {
+                edge_buffer &buffer_for_window = *new_edge_buffers[interval][w];
+                const edge_buffer_key * it, * end;
+                buffer_for_window.dst_range(interval_st, interval_en, it, end);
+                for(; it != end; ++it) {
+                    created_edge<EdgeDataType> * edge = buffer_for_window[it->idx];
+                    if (!edge->accounted_for_inc) {
+                        lo = std::min(lo, edge->dst);
+                        hi = std::max(hi, edge->dst);
+                    }
+                }
+            }
+            /* Load at most maxwindow degrees at a time */
+            for(vid_t st = lo; st <= hi; ) {
+                vid_t en = (hi - st > (vid_t)this->maxwindow ? st + this->maxwindow : hi);
+                this->degree_handler->load(st, en);
+                if (incorporate_new_edge_degrees(interval, st, en)) {
+                    this->degree_handler->save();
+                }
+                if (en == hi) break;
+                st = en + 1;
+            }
+        }
+        
         virtual vid_t determine_next_window(vid_t iinterval, vid_t fromvid, vid_t maxvid, size_t membudget) {
             /* Load degrees */
             this->degree_handler->load(fromvid, maxvid);
@@ -495,6 +702,9 @@ namespace graphchi {
             deletecounts.clear();
             for(int p=0; p < this->nshards; p++) 
                 deletecounts.push_back(0);
+            
+            /* Producers may wait for the first iteration to pass */
+            wake_producers();
         }
         
         virtual void iteration_finished() {
@@ -567,7 +777,7 @@ namespace graphchi {
             
             bool rangeschanged = false;
             state = "commit-ingests";
-            vid_t maxwindow = 4000000; // FIXME: HARDCODE
+            vid_t maxwindow = commit_maxwindow;
             size_t mem_budget = this->membudget_mb * 1024 * 1024;
             this->modification_lock.lock();
             
@@ -589,17 +799,38 @@ namespace graphchi {
             
             std::vector<bool> was_commited(this->nshards, true);
             
+            // Decide which shards to rewrite
+            std::vector<size_t> bufedges_per_shard(this->nshards, 0);
+            std::vector<bool> rewrite(this->nshards, false);
+            size_t remaining = 0;
             for(int shard=0; shard < this->nshards; shard++) {
-                std::vector<edge_buffer*> &shard_buffer = new_edge_buffers[shard];
-                
-                // Check there are any new edges
-                size_t bufedges = 0;
                 for(int w=0; w < this->nshards; w++) {
-                    bufedges += shard_buffer[w]->size();
-                    
+                    bufedges_per_shard[shard] += new_edge_buffers[shard][w]->size();
                 }
+                size_t bufedges = bufedges_per_shard[shard];
+                rewrite[shard] = bufedges >= min_buffer_in_shard_to_commit || deletecounts[shard] * 1.0 / edgespershard[shard] >= 0.2;
+                if (threshold_commit && bufedges < commit_ratio * edgespershard[shard] && deletecounts[shard] * 1.0 / edgespershard[shard] < 0.2) {
+                    rewrite[shard] = false;
+                }
+                if (!rewrite[shard]) remaining += bufedges;
+            }
+            while (threshold_commit && remaining > max_edge_buffer / 2) {
+                int best = -1;
+                for(int shard=0; shard < this->nshards; shard++) {
+                    if (rewrite[shard] || bufedges_per_shard[shard] == 0) continue;
+                    if (best < 0 || bufedges_per_shard[shard] * (edgespershard[best] + 1.0) > bufedges_per_shard[best] * (edgespershard[shard] + 1.0)) {
+                        best = shard;
+                    }
+                }
+                assert(best >= 0);
+                rewrite[best] = true;
+                remaining -= bufedges_per_shard[best];
+            }
+            
+            for(int shard=0; shard < this->nshards; shard++) {
+                size_t bufedges = bufedges_per_shard[shard];
                 
-                if (bufedges < min_buffer_in_shard_to_commit && deletecounts[shard] * 1.0 / edgespershard[shard] < 0.2) {
+                if (!rewrite[shard]) {
                     logstream(LOG_DEBUG) << shard << ": not enough edges for shard: " << bufedges << " deleted:" << deletecounts[shard] << "/" << edgespershard[shard] << std::endl;
                     newranges.push_back(this->intervals[shard]);
                     newsuffices.push_back(shard_suffices[shard]);
@@ -754,12 +985,11 @@ namespace graphchi {
                             curshard->read_next_vertices(nvertices, window_st, vertices, false, true);
                             
                             // Incorporate buffered edges
-                            for(unsigned int ebi=0; ebi<buffer_for_window.size(); ebi++) {
-                                created_edge<EdgeDataType> * edge = buffer_for_window[ebi];
-                                if (edge->src >= window_st && edge->src <= window_en) {
-                                    vertices[edge->src-window_st].add_outedge(edge->dst, &edge->data, false);
-                                    
-                                }
+                            const edge_buffer_key * it, * end;
+                            buffer_for_window.src_range(window_st, window_en, it, end);
+                            for(; it != end; ++it) {
+                                created_edge<EdgeDataType> * edge = buffer_for_window[it->idx];
+                                vertices[edge->src-window_st].add_outedge(edge->dst, &edge->data, false);
                             }
                             this->iomgr->wait_for_reads();
                             
@@ -917,7 +1147,8 @@ namespace graphchi {
             }
             
             // Update number of shards:
-            last_commit = added_edges;
+            // (with the threshold policy, edges left in buffers still count as buffered)
+            last_commit = added_edges - (threshold_commit ? remaining : 0);
             this->intervals = newranges;
             shard_suffices = newsuffices;
             this->nshards = (int) this->intervals.size();
@@ -939,6 +1170,9 @@ namespace graphchi {
             
             init_buffers();
             this->modification_lock.unlock();
+            
+            /* Buffers are drained: producers may continue */
+            wake_producers();
         }
         
         
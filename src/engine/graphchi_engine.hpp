@@ -56,8 +56,8 @@
 #include "shards/slidingshard.hpp"
 #include "util/pthread_tools.hpp"
 #include "output/output.hpp"
+#include "engine/stream_coordinator.hpp"
 /* Unicorn header file */
-#include "../extern/extern.hpp"
 
 namespace graphchi {
 
@@ -675,12 +675,18 @@ namespace graphchi {
         // TODO: support for a minimum fraction of scheduled vertices
         bool is_any_vertex_scheduled(vid_t st, vid_t en) {
             if (scheduler == NULL) return true;
-            for(vid_t v=st; v<=en; v++) {
-                if (scheduler->is_scheduled(v)) {
-                    return true;
-                }
-            }
-            return false;
+            return scheduler->is_any_scheduled(st, en);
+        }
+        
+        /**
+         * Called, under the modification lock, instead of executing
+         * an interval with no scheduled vertices. Its memory shard
+         * is not created, so its sliding shard keeps its position;
+         * the other sliding shards skip the interval's vertices
+         * when they are next read.
+         */
+        virtual void skip_interval(int interval, vid_t interval_st, vid_t interval_en) {
+            // Do nothing
         }
         
         virtual void initialize_iter() {
@@ -811,7 +817,7 @@ namespace graphchi {
 #ifdef DEBUG
                             logstream(LOG_DEBUG) << "(Unicorn) No new tasks to run!" << std::endl;
 #endif
-                            std::no_new_tasks = true;
+                            stream_coordinator::get_instance()->set_no_new_tasks(true);
                             // break;
                         }
                         scheduler->has_new_tasks = false; // Kind of misleading since scheduler may still have tasks - but no new tasks.
@@ -854,6 +860,21 @@ namespace graphchi {
                     if (!is_inmemory_mode())
                         userprogram.before_exec_interval(interval_st, interval_en, chicontext);
 
+                    /* Skip the whole interval if none of its vertices is scheduled */
+                    if (!is_inmemory_mode() && scheduler != NULL) {
+                        modification_lock.lock();
+                        bool any_vertex_scheduled = is_any_vertex_scheduled(interval_st, interval_en);
+                        if (!any_vertex_scheduled) {
+                            skip_interval(exec_interval, interval_st, interval_en);
+                        }
+                        modification_lock.unlock();
+                        if (!any_vertex_scheduled) {
+                            logstream(LOG_DEBUG) << "No vertices scheduled in interval " << exec_interval << ", skip." << std::endl;
+                            userprogram.after_exec_interval(interval_st, interval_en, chicontext);
+                            continue;
+                        }
+                    }
+
                     /* Flush stream shard for the exec interval */
                     sliding_shards[exec_interval]->flush();
                     iomgr->wait_for_writes(); // Actually we would need to only wait for         writes of given shard. TODO.
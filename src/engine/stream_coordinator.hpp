@@ -0,0 +1,134 @@
+/**
+ * @file
+ *
+ * @section DESCRIPTION
+ *
+ * Coordination between the engine and a thread that streams
+ * new edges into a dynamic graph (Unicorn's stream reader).
+ */
+
+#ifndef GRAPHCHI_STREAM_COORDINATOR_DEF
+#define GRAPHCHI_STREAM_COORDINATOR_DEF
+
+#include <atomic>
+#include <pthread.h>
+
+#include "util/pthread_tools.hpp"
+
+namespace graphchi {
+
+    /**
+     * Shared state of the engine and the stream thread. We use singleton
+     * design so that the engine, the program and the stream thread
+     * refer to the same object.
+     * - The engine sets no_new_tasks when an iteration has no new tasks.
+     * - The program marks the base graph constructed; the stream thread
+     *   blocks (instead of spinning) until it is.
+     * - The stream thread sets stop once it has streamed all edges.
+     * - The program and the stream thread meet at the stream barrier
+     *   (new edges may be streamed) and at the graph barrier (new edges
+     *   are added, computation resumes). Setting stop releases the
+     *   program from the stream barrier, since the stream thread will
+     *   not come (a live stream may end long after the last batch).
+     */
+    class stream_coordinator {
+    public:
+        static stream_coordinator * get_instance() {
+            static stream_coordinator coordinator;
+            return &coordinator;
+        }
+
+        void set_base_graph_constructed() {
+            lock.lock();
+            base_graph_constructed = true;
+            cond.broadcast();
+            lock.unlock();
+        }
+
+        /**
+         * Block until set_base_graph_constructed() is called.
+         */
+        void wait_for_base_graph() {
+            if (base_graph_constructed) return;
+            lock.lock();
+            while (!base_graph_constructed) {
+                cond.wait(lock);
+            }
+            lock.unlock();
+        }
+
+        bool is_base_graph_constructed() const {
+            return base_graph_constructed;
+        }
+
+        void set_no_new_tasks(bool b) {
+            no_new_tasks = b;
+        }
+
+        bool has_no_new_tasks() const {
+            return no_new_tasks;
+        }
+
+        void set_stop() {
+            lock.lock();
+            stop = true;
+            cond.broadcast();
+            lock.unlock();
+        }
+
+        bool is_stopped() const {
+            return stop;
+        }
+
+        /**
+         * Wait for the other thread at the stream barrier. Returns
+         * false, without waiting, once stop is set.
+         */
+        bool wait_stream_barrier() {
+            lock.lock();
+            bool passed = false;
+            if (stream_waiting) {
+                /* The other thread is waiting: release it */
+                stream_waiting = false;
+                stream_generation++;
+                cond.broadcast();
+                passed = true;
+            } else if (!stop) {
+                stream_waiting = true;
+                size_t generation = stream_generation;
+                while (generation == stream_generation && !stop) {
+                    cond.wait(lock);
+                }
+                passed = generation != stream_generation;
+                if (!passed) stream_waiting = false;
+            }
+            lock.unlock();
+            return passed;
+        }
+
+        void wait_graph_barrier() {
+            pthread_barrier_wait(&graph_barrier);
+        }
+
+    private:
+        stream_coordinator() : base_graph_constructed(false), no_new_tasks(false), stop(false),
+            stream_waiting(false), stream_generation(0) {
+            pthread_barrier_init(&graph_barrier, NULL, 2);
+        }
+
+        ~stream_coordinator() {
+            pthread_barrier_destroy(&graph_barrier);
+        }
+
+        std::atomic<bool> base_graph_constructed;
+        std::atomic<bool> no_new_tasks;
+        std::atomic<bool> stop;
+        mutex lock;
+        conditional cond;
+        bool stream_waiting; /* A thread waits at the stream barrier (under lock) */
+        size_t stream_generation; /* Times the stream barrier was passed (under lock) */
+        pthread_barrier_t graph_barrier;
+    };
+}
+
+#endif
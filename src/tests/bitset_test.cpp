@@ -0,0 +1,274 @@
+
+/**
+ * @file
+ * @author  Aapo Kyrola <akyrola@cs.cmu.edu>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * Copyright [2012] [Aapo Kyrola, Guy Blelloch, Carlos Guestrin / Carnegie Mellon University]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+
+ *
+ * @section DESCRIPTION
+ *
+ * Tests dense_bitset::any(), clear_bits() and resize() against a
+ * reference set of bit positions. Ranges cross word (64-bit),
+ * block (4096-bit) and summary word (262144-bit) boundaries.
+ *
+ * With ATOMIC_SCHEDULER, also tests the chunked bitset of the
+ * lock-free scheduler; build it with a small SCHEDULER_CHUNK_BITS
+ * (make tests/bitset_test_atomic) so that ranges span many chunks.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <iostream>
+#include <set>
+
+#include "util/dense_bitset.hpp"
+#ifdef ATOMIC_SCHEDULER
+#include "engine/atomic_bitset_scheduler.hpp"
+#endif
+
+using namespace graphchi;
+
+/**
+ * Bits that should be set, for checking any() by lookup.
+ */
+struct reference_bitset {
+    std::set<uint32_t> bits;
+
+    void set_bit(uint32_t b) {
+        bits.insert(b);
+    }
+
+    void clear_bits(uint32_t fromb, uint32_t tob) {
+        bits.erase(bits.lower_bound(fromb), bits.upper_bound(tob));
+    }
+
+    bool any(uint32_t fromb, uint32_t tob) const {
+        std::set<uint32_t>::const_iterator it = bits.lower_bound(fromb);
+        return it != bits.end() && *it <= tob;
+    }
+};
+
+static uint32_t random_below(uint32_t n) {
+    return (uint32_t) ((((uint64_t) rand() << 31) ^ (uint64_t) rand()) % n);
+}
+
+void test_boundaries() {
+    dense_bitset b(3 * 4096 + 100);
+    assert(!b.any(0, 3 * 4096 + 99));
+
+    b.set_bit(63);
+    assert(!b.any(0, 62));
+    assert(b.any(63, 63));
+    assert(b.any(60, 70));
+    assert(!b.any(64, 3 * 4096 + 99));
+
+    b.set_bit(4095);
+    assert(!b.any(64, 4094));
+    assert(b.any(4095, 4095));
+    assert(b.any(4000, 4100));
+    assert(!b.any(4096, 2 * 4096 - 1));
+
+    b.set_bit(2 * 4096);
+    assert(!b.any(4096, 2 * 4096 - 1));
+    assert(b.any(4096, 2 * 4096));
+    assert(b.any(2 * 4096, 2 * 4096));
+    assert(!b.any(2 * 4096 + 1, 3 * 4096 + 99));
+
+    assert(!b.any(10, 9));
+}
+
+void test_clear_bits() {
+    const uint32_t n = 5 * 4096;
+    dense_bitset b(n);
+    for(uint32_t i = 4000; i < 8300; i += 7) {
+        b.set_bit(i);
+    }
+    b.set_bit(3999);
+    b.set_bit(8300);
+
+    // From the middle of a word in one block to the middle of a word in another
+    b.clear_bits(4000, 8299);
+    assert(!b.any(4000, 8299));
+    assert(b.any(3999, 3999));
+    assert(b.any(8300, 8300));
+    assert(b.any(3990, 4010));
+    assert(b.any(8290, 8310));
+
+    // Whole words
+    b.set_bit(128);
+    b.set_bit(191);
+    b.clear_bits(128, 191);
+    assert(!b.any(128, 191));
+
+    b.clear_bits(0, n - 1);
+    assert(!b.any(0, n - 1));
+}
+
+void test_resize_growth() {
+    dense_bitset b(100);
+    b.set_bit(99);
+
+    // New words, blocks and summary words start clear
+    b.resize(600000);
+    assert(!b.any(100, 599999));
+    assert(b.any(0, 599999));
+
+    b.set_bit(599999);
+    b.set_bit(300000);
+    assert(b.any(299999, 300001));
+    assert(!b.any(100, 299999));
+    assert(!b.any(300001, 599998));
+    assert(b.any(599999, 599999));
+
+    // Growing one bit at a time
+    dense_bitset g;
+    for(uint32_t n = 1; n <= 20000; n++) {
+        g.resize(n);
+        assert(!g.any(n - 1, n - 1));
+        if (n % 1000 == 0) g.set_bit(n - 1);
+    }
+    for(uint32_t n = 1000; n <= 20000; n += 1000) {
+        assert(g.any(n - 1, n - 1));
+        assert(!g.any(n - 1000, n - 2));
+    }
+}
+
+void test_random() {
+    uint32_t n = 1000;
+    dense_bitset b(n);
+    reference_bitset ref;
+
+    for(int round = 0; round < 200; round++) {
+        if (round % 20 == 0) {
+            n += random_below(100000);
+            b.resize(n);
+        }
+        int nsets = (int) random_below(200);
+        for(int i = 0; i < nsets; i++) {
+            uint32_t x = random_below(n);
+            b.set_bit(x);
+            ref.set_bit(x);
+        }
+        for(int i = 0; i < 10; i++) {
+            uint32_t from = random_below(n), to = from + random_below(n - from);
+            b.clear_bits(from, to);
+            ref.clear_bits(from, to);
+        }
+        for(int i = 0; i < 200; i++) {
+            uint32_t from = random_below(n);
+            uint32_t to = from + random_below(std::min(n - from, i % 2 == 0 ? 200u : n));
+            assert(b.any(from, to) == ref.any(from, to));
+        }
+    }
+}
+
+#ifdef ATOMIC_SCHEDULER
+void test_chunk_boundaries() {
+    const uint32_t cb = 1u << SCHEDULER_CHUNK_BITS;
+    chunked_bitset * b = new chunked_bitset(3 * cb + 5);
+    assert(!b->any(0, 3 * cb + 4));
+
+    b->set_bit(cb - 1);
+    b->set_bit(cb);
+    assert(!b->any(0, cb - 2));
+    assert(b->any(cb - 1, cb - 1));
+    assert(b->any(cb, cb));
+    assert(!b->any(cb + 1, 3 * cb + 4));
+
+    b->set_bit(2 * cb + 7);
+    b->set_bit(3 * cb + 4);
+
+    // Clear a range that spans three chunks
+    b->clear_bits(cb - 10, 3 * cb);
+    assert(!b->any(0, 3 * cb));
+    assert(!b->get(cb - 1) && !b->get(cb) && !b->get(2 * cb + 7));
+    assert(b->any(3 * cb + 4, 3 * cb + 4));
+    assert(b->any(0, 3 * cb + 4));
+    delete b;
+}
+
+void test_beyond_size() {
+    const uint32_t cb = 1u << SCHEDULER_CHUNK_BITS;
+    chunked_bitset * b = new chunked_bitset(100);
+
+    // Chunks past the last resize() are allocated on demand
+    b->set_bit(5 * cb + 3);
+    assert(b->size() == 100);
+    assert(b->get(5 * cb + 3));
+    assert(!b->any(0, 5 * cb + 2));
+    assert(b->any(0, 6 * cb - 1));
+    assert(!b->any(5 * cb + 4, 8 * cb));
+
+    b->set_bit(cb + 1);
+    b->clear_bits(50, 8 * cb);
+    assert(!b->any(0, 8 * cb));
+
+    b->resize(7 * cb);
+    b->set_bit(5 * cb + 3);
+    assert(b->any(5 * cb, 5 * cb + 3));
+    delete b;
+}
+
+void test_chunked_random() {
+    uint32_t n = 1000;
+    chunked_bitset * b = new chunked_bitset(n);
+    reference_bitset ref;
+
+    for(int round = 0; round < 200; round++) {
+        if (round % 20 == 0) {
+            n += random_below(50000);
+            b->resize(n);
+        }
+        // Also set bits up to twice the current size
+        int nsets = (int) random_below(200);
+        for(int i = 0; i < nsets; i++) {
+            uint32_t x = random_below(2 * n);
+            b->set_bit(x);
+            ref.set_bit(x);
+        }
+        for(int i = 0; i < 10; i++) {
+            uint32_t from = random_below(2 * n), to = from + random_below(2 * n - from);
+            b->clear_bits(from, to);
+            ref.clear_bits(from, to);
+        }
+        for(int i = 0; i < 200; i++) {
+            uint32_t from = random_below(2 * n);
+            uint32_t to = from + random_below(std::min(2 * n - from, i % 2 == 0 ? 200u : 2 * n));
+            assert(b->any(from, to) == ref.any(from, to));
+        }
+    }
+    delete b;
+}
+#endif
+
+int main(int argc, const char ** argv) {
+    srand(12345);
+    test_boundaries();
+    test_clear_bits();
+    test_resize_growth();
+    test_random();
+#ifdef ATOMIC_SCHEDULER
+    test_chunk_boundaries();
+    test_beyond_size();
+    test_chunked_random();
+#endif
+    std::cout << "Bitset test passed." << std::endl;
+    return 0;
+}
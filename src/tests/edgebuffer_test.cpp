@@ -0,0 +1,113 @@
+
+/**
+ * @file
+ * @author  Aapo Kyrola <akyrola@cs.cmu.edu>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * Copyright [2012] [Aapo Kyrola, Guy Blelloch, Carlos Guestrin / Carnegie Mellon University]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+
+ *
+ * @section DESCRIPTION
+ *
+ * Tests the source and destination indices of edge_buffer_flat.
+ * Edges are added over several rounds, with range queries between
+ * them, so that the indices are merged lazily many times. Each query
+ * is checked against a linear scan of the buffer, and edges of one
+ * vertex must come in the order they were added.
+ */
+
+#include <assert.h>
+#include <algorithm>
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+
+#include "graphchi_types.hpp"
+#include "engine/dynamic_graphs/edgebuffers.hpp"
+
+using namespace graphchi;
+
+/**
+ * Checks one src_range() or dst_range() query against a linear scan.
+ */
+void check_range(edge_buffer_flat<int> &buf, vid_t st, vid_t en, bool src) {
+    const edge_buffer_key * begin, * end;
+    if (src) buf.src_range(st, en, begin, end);
+    else buf.dst_range(st, en, begin, end);
+
+    std::vector<unsigned int> expected;
+    for(unsigned int i=0; i < buf.size(); i++) {
+        created_edge<int> * edge = buf[i];
+        vid_t vid = (src ? edge->src : edge->dst);
+        if (vid >= st && vid <= en) expected.push_back(i);
+    }
+    assert(expected.size() == (size_t) (end - begin));
+
+    std::vector<unsigned int> found;
+    for(const edge_buffer_key * k = begin; k != end; ++k) {
+        created_edge<int> * edge = buf[k->idx];
+        assert(k->vid == (src ? edge->src : edge->dst));
+        assert(edge->data == (int) k->idx);
+        if (k != begin) {
+            // Sorted by vertex, and in insertion order within a vertex
+            assert((k - 1)->vid < k->vid || ((k - 1)->vid == k->vid && (k - 1)->idx < k->idx));
+        }
+        found.push_back(k->idx);
+    }
+    std::sort(found.begin(), found.end());
+    assert(found == expected);
+}
+
+int main(int argc, const char ** argv) {
+    srand(12345);
+    const vid_t nvertices = 5000;
+    edge_buffer_flat<int> buf;
+
+    // Empty buffer
+    check_range(buf, 0, nvertices, true);
+    check_range(buf, 0, nvertices, false);
+
+    for(int round = 0; round < 40; round++) {
+        // Some rounds add more than a chunk of EDGE_BUFFER_CHUNKSIZE edges
+        int nadd = (round % 10 == 9 ? EDGE_BUFFER_CHUNKSIZE + 100 : rand() % 2000);
+        for(int i = 0; i < nadd; i++) {
+            // Few distinct vertices, so that vertices have edges from many rounds
+            vid_t src = (vid_t) (rand() % (round % 2 == 0 ? 50 : nvertices));
+            vid_t dst = (vid_t) (rand() % nvertices);
+            buf.add(src, dst, (int) buf.size());
+        }
+        // Query only one of the indices in some rounds, so that the other
+        // has more edges to merge in later
+        for(int q = 0; q < 5; q++) {
+            vid_t st = (vid_t) (rand() % nvertices);
+            vid_t en = st + (vid_t) (rand() % (q == 0 ? 3 : nvertices));
+            if (round % 3 != 1) check_range(buf, st, en, true);
+            if (round % 3 != 2) check_range(buf, st, en, false);
+        }
+    }
+    check_range(buf, 0, nvertices, true);
+    check_range(buf, 0, nvertices, false);
+
+    buf.clear();
+    check_range(buf, 0, nvertices, true);
+    buf.add(7, 3, 0);
+    check_range(buf, 0, nvertices, true);
+    check_range(buf, 3, 3, false);
+
+    std::cout << "Edge buffer test passed." << std::endl;
+    return 0;
+}
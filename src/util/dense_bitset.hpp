@@ -3,39 +3,66 @@
 
 #ifndef DENSE_BITSET_HPP
 #define DENSE_BITSET_HPP
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <stdint.h>
 
 namespace graphchi {
+    /**
+     * Besides the bits, we keep a summary with one bit per block of
+     * 64 words (4096 bits). A summary bit is set whenever a bit in
+     * its block is set, but is only cleared by clear(), so a clear
+     * summary bit means the block is empty. any() uses it to skip
+     * empty blocks.
+     */
     class dense_bitset {
     public:
-        dense_bitset() : array(NULL), len(0) {
+        dense_bitset() : array(NULL), summary(NULL), len(0), arrlen(0), sumlen(0), arrcap(0), sumcap(0) {
             generate_bit_masks();
         }
         
-        dense_bitset(size_t size) : array(NULL), len(size) {
+        dense_bitset(size_t size) : array(NULL), summary(NULL), len(size), arrlen(0), sumlen(0), arrcap(0), sumcap(0) {
             resize(size);
             clear();
             generate_bit_masks();
         }
         
         
-        virtual ~dense_bitset() {free(array);}
+        virtual ~dense_bitset() {free(array); free(summary);}
         
+        /**
+         * Sets the number of bits. Memory is never released when
+         * the bitset shrinks.
+         */
         void resize(size_t n) {
             len = n;
             //need len bits
+            size_t oldarrlen = arrlen, oldsumlen = sumlen;
             arrlen =  n / (8*sizeof(size_t)) + 1;
-            array = (size_t*)realloc(array, sizeof(size_t) * arrlen);
+            sumlen = arrlen / (8*sizeof(size_t)) / (8*sizeof(size_t)) + 1;
+            if (arrlen > arrcap) {
+                arrcap = std::max(arrlen, 2 * arrcap);
+                array = (size_t*)realloc(array, sizeof(size_t) * arrcap);
+            }
+            if (sumlen > sumcap) {
+                sumcap = std::max(sumlen, 2 * sumcap);
+                summary = (size_t*)realloc(summary, sizeof(size_t) * sumcap);
+            }
+            // New bits are clear, as the summary says
+            for (size_t i = oldarrlen; i < arrlen; ++i) array[i] = 0;
+            for (size_t i = oldsumlen; i < sumlen; ++i) summary[i] = 0;
         }
         
         void clear() {
             for (size_t i = 0;i < arrlen; ++i) array[i] = 0;
+            for (size_t i = 0;i < sumlen; ++i) summary[i] = 0;
         }
         
         void setall() {
             memset(array, 0xff,  arrlen * sizeof(size_t));
+            memset(summary, 0xff,  sumlen * sizeof(size_t));
         }
         
         inline bool get(uint32_t b) const{
@@ -50,6 +77,7 @@ namespace graphchi {
             uint32_t arrpos, bitpos;
             bit_to_pos(b, arrpos, bitpos);
             const size_t mask(size_t(1) << size_t(bitpos)); 
+            set_summary_bit(arrpos);
             return __sync_fetch_and_or(array + arrpos, mask) & mask;
         }
         
@@ -90,12 +118,52 @@ namespace graphchi {
             memset(&array[from_arrpos], 0, (to_arrpos-from_arrpos) * (int)  sizeof(size_t));
         }
         
+        /**
+         * Returns true if any bit in [fromb, tob] (inclusive) is set.
+         * Empty blocks of the summary are skipped without looking
+         * at their words.
+         */
+        inline bool any(uint32_t fromb, uint32_t tob) const {
+            if (fromb > tob) return false;
+            const size_t bitsperword = sizeof(size_t)*8;
+            size_t from_arrpos = fromb / bitsperword;
+            size_t to_arrpos = tob / bitsperword;
+            size_t i = from_arrpos;
+            while (i <= to_arrpos) {
+                size_t block = i / bitsperword;
+                size_t sumword = summary[block / bitsperword];
+                if (sumword == 0) {
+                    // No bits in the next 64 blocks
+                    i = (block / bitsperword + 1) * bitsperword * bitsperword;
+                    continue;
+                }
+                if (!(sumword & (size_t(1) << (block % bitsperword)))) {
+                    i = (block + 1) * bitsperword;
+                    continue;
+                }
+                size_t word = array[i];
+                if (i == from_arrpos) word &= size_t(-1) << (fromb % bitsperword);
+                if (i == to_arrpos && tob % bitsperword != bitsperword - 1) {
+                    word &= (size_t(1) << (tob % bitsperword + 1)) - 1;
+                }
+                if (word != 0) return true;
+                i++;
+            }
+            return false;
+        }
                 
         inline size_t size() const {
             return len;
         }
         
     private:
+        
+        inline void set_summary_bit(uint32_t arrpos) {
+            size_t block = arrpos / (8 * sizeof(size_t));
+            const size_t mask(size_t(1) << (block % (8 * sizeof(size_t))));
+            size_t * sumword = summary + block / (8 * sizeof(size_t));
+            if (!(*sumword & mask)) __sync_fetch_and_or(sumword, mask);
+        }
                 
         
         inline static void bit_to_pos(uint32_t b, uint32_t &arrpos, uint32_t &bitpos) {
@@ -129,8 +197,12 @@ namespace graphchi {
         }
         
         size_t* array;
+        size_t* summary; // One bit per block of 64 words
         size_t len;
         size_t arrlen;
+        size_t sumlen;
+        size_t arrcap; // Allocated words
+        size_t sumcap;
         // selectbit[i] has a bit in the i'th position
         size_t selectbit[8 * sizeof(size_t)];
         size_t notselectbit[8 * sizeof(size_t)];
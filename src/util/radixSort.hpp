@@ -81,16 +81,12 @@ namespace graphchi {
         return a;
     }
     
-    // Radix sort with low order bits first
+    // Radix sort with low order bits first, using caller-owned
+    // temporary space: B and Tmp of n elements, counts of BUCKETS
     template <class E, class F>
-    void iSort(E *A, intT n, intT m, F f) {
+    void iSort(E *A, intT n, intT m, F f, E* B, bIndexT* Tmp, intT* counts) {
         intT bits = log2Up(m);
         
-        // temporary space
-        E* B = (E*) malloc(sizeof(E)*n);
-        bIndexT* Tmp = (bIndexT*) malloc(sizeof(bIndexT)*n);
-        intT* counts = (intT*) malloc(sizeof(intT)*BUCKETS);
-        
         intT rounds = 1+(bits-1)/MAX_RADIX;
         intT rbits = 1+(bits-1)/rounds;
         intT bitOffset = 0;
@@ -111,6 +107,17 @@ namespace graphchi {
         if (flipped)
             for (intT i=0; i < n; i++)
                 A[i] = B[i];
+    }
+    
+    // Radix sort with low order bits first
+    template <class E, class F>
+    void iSort(E *A, intT n, intT m, F f) {
+        // temporary space
+        E* B = (E*) malloc(sizeof(E)*n);
+        bIndexT* Tmp = (bIndexT*) malloc(sizeof(bIndexT)*n);
+        intT* counts = (intT*) malloc(sizeof(intT)*BUCKETS);
+        
+        iSort(A, n, m, f, B, Tmp, counts);
         
         free(B); free(Tmp); free(counts);
     }
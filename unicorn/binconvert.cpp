@@ -0,0 +1,131 @@
+/*
+ *
+ * Author: Xueyuan Han <hanx@g.harvard.edu>
+ *
+ * Copyright (C) 2018-2020 Harvard University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ */
+
+/* Convert a text base or stream graph file into the
+ * pre-parsed binary format (see binary_format.hpp):
+ * bin/unicorn/binconvert input <TEXT_FILE> output <BINARY_FILE> kind <base_OR_stream>
+ * Unicorn reads the binary file in place of the text
+ * file, and produces the same sketches. */
+
+#include <cstdio>
+#include <string>
+/* NOTE: helper.hpp must be included first. */
+#include "include/helper.hpp"
+#include "include/def.hpp"
+#include "include/binary_format.hpp"
+#include "include/stream_reader.hpp"
+/* GraphChi header files we use. */
+#include "graphchi_basic_includes.hpp"
+#include "logger/logger.hpp"
+
+using namespace graphchi;
+
+/* The following variables are declared in def.hpp. */
+int DECAY;
+float LAMBDA;
+bool LAZY_DECAY = false;
+int HIST_SHARDS;
+bool COUNTER_RNG = false;
+int WINDOW;
+int BATCH;
+bool CHUNKIFY = true;
+int CHUNK_SIZE;
+bool BINARY_RELABEL = false;
+int RADIX_THRESHOLD;
+FILE * SFP;
+#ifdef VIZ
+std::string HIST_FILE;
+#endif
+
+/* Parse a line of a base graph file the way GraphChi's
+ * edgelist conversion and parse() in helper.hpp do.
+ * Returns false for comment lines. */
+static bool parse_base_line(const char* line, size_t len, vid_t &src, vid_t &dst, edge_label<1> &e) {
+    std::string s(line, len);
+    if (s.empty() || s[0] == '#' || s[0] == '%')
+        return false;
+    char delims[] = "\t, ";
+    char *t = strtok(&s[0], delims);
+    if (t == NULL)
+        logstream(LOG_ERROR) << "Source ID is missing." << std::endl;
+    assert(t != NULL);
+    src = atoi(t);
+    t = strtok(NULL, delims);
+    if (t == NULL)
+        logstream(LOG_ERROR) << "Destination ID is missing." << std::endl;
+    assert(t != NULL);
+    dst = atoi(t);
+    t = strtok(NULL, delims);
+    if (t == NULL)
+        logstream(LOG_ERROR) << "Edge labels are missing." << std::endl;
+    assert(t != NULL);
+    parse(e, (const char*)t);
+    return true;
+}
+
+int main(int argc, const char ** argv) {
+    graphchi_init(argc, argv);
+    global_logger().set_log_level(LOG_INFO);
+
+    std::string input = get_option_string("input");
+    std::string output = get_option_string("output");
+    std::string kind_str = get_option_string("kind", "stream");
+    uint32_t kind;
+    if (kind_str == "base") kind = BINARY_KIND_BASE;
+    else if (kind_str == "stream") kind = BINARY_KIND_STREAM;
+    else {
+        logstream(LOG_ERROR) << "Unknown kind: " << kind_str << ". Use base or stream." << std::endl;
+        assert(false);
+    }
+
+    StreamReader reader(input);
+    FILE* out = fopen(output.c_str(), "wb");
+    if (out == NULL)
+        logstream(LOG_ERROR) << "Cannot open the file to write: " << output << ". Error code: " << strerror(errno) << std::endl;
+    assert(out != NULL);
+    binary_header header;
+    init_binary_header(&header, kind);
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+
+    const char* line;
+    size_t len;
+    unsigned long nrecords = 0;
+    while (ok && reader.next_line(&line, &len)) {
+        vid_t src, dst;
+        edge_label<1> e = edge_label<1>();
+        if (kind == BINARY_KIND_BASE) {
+            if (!parse_base_line(line, len, src, dst, e))
+                continue;
+        } else {
+            parse_stream_edge(line, len, src, dst, e);
+        }
+        binary_record r;
+        memset(&r, 0, sizeof(r));
+        r.src = src;
+        r.dst = dst;
+        r.src_label = e.get_src(0);
+        r.dst_label = e.get_dst();
+        r.edge_label = e.get_edg();
+        r.time = e.get_tme(0);
+        r.new_src = e.new_src ? 1 : 0;
+        r.new_dst = e.new_dst ? 1 : 0;
+        ok = fwrite(&r, sizeof(r), 1, out) == 1;
+        nrecords++;
+    }
+    if (fclose(out) != 0 || !ok || !reader.close()) {
+        logstream(LOG_ERROR) << "Unable to write the binary graph file: " << output << std::endl;
+        return -1;
+    }
+    logstream(LOG_INFO) << "Wrote " << nrecords << " records to " << output << std::endl;
+    return 0;
+}
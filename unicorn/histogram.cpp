@@ -11,69 +11,151 @@
  *
  */
 
+#include <algorithm>
 #include <fstream>
 #include <math.h>
 #include <random>
 #include <cstdlib>
+#include <cstring>
 #include <string>
 
 #include "include/histogram.hpp"
 
-Histogram* Histogram::histogram;
+template <int SK>
+Histogram<SK>* Histogram<SK>::histogram;
 
 /* Singleton should always return the same instance. */
-Histogram* Histogram::get_instance() {
+template <int SK>
+Histogram<SK>* Histogram<SK>::get_instance() {
     if (!histogram)
-        histogram = new Histogram();
+        histogram = new Histogram<SK>();
     return histogram;
 }
 
-Histogram::~Histogram() {
-    delete histogram;
+template <int SK>
+Histogram<SK>::~Histogram() {
+    for (int i = 0; i < this->nshards; i++)
+        delete this->shards[i];
+    delete[] this->stripe_locks;
+    pthread_rwlock_destroy(&this->scale_lock);
 }
 
-/* Sample random values for hashing histogram. */
-struct hist_elem Histogram::construct_hist_elem(unsigned long label) {
-    struct hist_elem new_elem;
+/* Sample random values for hashing histogram.
+ * Distributions are local so that concurrent
+ * calls do not share any state. */
+template <int SK>
+struct hist_elem<SK> Histogram<SK>::construct_hist_elem(unsigned long label) {
+    struct hist_elem<SK> new_elem;
+    if (COUNTER_RNG) {
+        /* Slot i uses counters 2i (r) and 2i + 1 (c) of the gamma
+	 * stream and counter 4 * SK + i of the uniform stream
+	 * (the gamma stream takes two uniforms per counter). */
+        for (int i = 0; i < SK; i++) {
+            new_elem.r[i] = counter_gamma2(label, 2 * i);
+            new_elem.beta[i] = counter_uniform(label, 4 * SK + i);
+            new_elem.c[i] = counter_gamma2(label, 2 * i + 1);
+        }
+        return new_elem;
+    }
+    std::gamma_distribution<double> gamma_dist(2.0, 1.0);
+    std::uniform_real_distribution<double> uniform_dist(0.0, 1.0);
     std::default_random_engine r_generator(label);
     std::default_random_engine c_generator(label / 2);
     std::default_random_engine beta_generator(label);
-    for (int i = 0; i < SKETCH_SIZE; i++) {
+    for (int i = 0; i < SK; i++) {
         new_elem.r[i] = gamma_dist(r_generator);
         new_elem.beta[i] = uniform_dist(beta_generator);
         new_elem.c[i] = gamma_dist(c_generator);
     }
-    gamma_dist.reset();
     return new_elem;
 }
 
-/* Decay values in the histogram map, and record the sketch to the 
- * file @fp, if WINDOW updates have performed (if WINDOW is used). */
-void Histogram::decay(FILE* fp) {
-    this->histogram_map_lock.lock();
-    this->t++;
-#ifdef USEWINDOW
-    this->w++;
+/* Pick the shard that holds @label. We mix the label
+ * differently from FlatTable so that labels in the same
+ * shard still spread over the whole table. */
+template <int SK>
+HistogramShard* Histogram<SK>::shard_for(unsigned long label) {
+    unsigned long h = label ^ (label >> 31);
+    h *= 0xBF58476D1CE4E5B9UL;
+    h ^= h >> 29;
+    return this->shards[h % this->nshards];
+}
+
+#ifdef MEMORY
+/* We use @label to decide which pre-sampled values to use
+ * so we will always use the same values for the same label.
+ * In COUNTER_RNG mode, the indices come from a counter hash.
+ * Otherwise, this is srand(label) followed by two rand() calls, but on a
+ * per-thread generator state so concurrent updates do not
+ * race on the global libc state. glibc's rand() is random(),
+ * so random_r() on a 128-byte state yields the same values. */
+template <int SK>
+void Histogram<SK>::param_index(unsigned long label, int &pos1, int &pos2) {
+    if (COUNTER_RNG) {
+        /* One stateless hash gives both indices. */
+        uint64_t h = counter_hash(label, 0);
+        pos1 = counter_range((uint32_t)h, PREGEN);
+        pos2 = counter_range((uint32_t)(h >> 32), PREGEN);
+        return;
+    }
+    static thread_local char state[128];
+    static thread_local struct random_data rand_data;
+    static thread_local bool initialized = false;
+    if (!initialized) {
+        memset(&rand_data, 0, sizeof(rand_data));
+        initstate_r(1, state, sizeof(state), &rand_data);
+        initialized = true;
+    }
+    int32_t r1, r2;
+    srandom_r((unsigned int)label, &rand_data);
+    random_r(&rand_data, &r1);
+    random_r(&rand_data, &r2);
+    pos1 = r1 % PREGEN; /* For gamma and uniform distribution. */
+    pos2 = r2 % PREGEN; /* For the other gamma distribution. */
+}
 #endif
-    /* Decay only when t == DECAY. */
-    if (this->t >= DECAY) {
-        std::map<unsigned long, double>::iterator it;
-	/* Decay histogram values. */
-        for (it = this->histogram_map.begin(); it != this->histogram_map.end(); it++)
-            it->second *= this->powerful;
-	/* Decay sketch values. */
-        for (int i = 0; i < SKETCH_SIZE; i++)
-            this->hash[i] *= this->powerful;
-        this->t = 0;  /* Reset the timer. */
+
+/* Returns true once every @every calls. */
+static inline bool tick(std::atomic<unsigned long> &counter, int every) {
+    unsigned long n = ++counter;
+    return every <= 1 || n % every == 0;
+}
+
+/* Decay values in the histogram map, and record the sketch to the
+ * file @fp, if WINDOW updates have performed (if WINDOW is used). */
+template <int SK>
+void Histogram<SK>::decay(FILE* fp) {
+    /* Decay only every DECAY calls. */
+    if (tick(this->t, DECAY)) {
+        pthread_rwlock_wrlock(&this->scale_lock);
+        if (LAZY_DECAY) {
+            /* Decay histogram values and sketch values
+             * at once by decaying the global scale. */
+            this->scale *= this->powerful;
+            if (this->scale < LAZY_DECAY_RENORM)
+                this->renormalize();
+        } else {
+	    /* Decay histogram values. */
+            for (int p = 0; p < this->nshards; p++) {
+                FlatTable<double> &table = this->shards[p]->table;
+                for (size_t s = 0; s < table.slots(); s++)
+                    if (table.occupied(s))
+                        table.value_at(s) *= this->powerful;
+            }
+	    /* Decay sketch values. */
+            for (int i = 0; i < SK; i++)
+                this->hash[i] *= this->powerful;
+        }
+        pthread_rwlock_unlock(&this->scale_lock);
     }
-    /* Record sketch only when t == WINDOW if we use
+    /* Record sketch only every WINDOW calls if we use
      * WINDOW as frequency to generate sketches. */
 #ifdef USEWINDOW
-    if (this->w >= WINDOW) {
-        for (int i = 0; i < SKETCH_SIZE; i++)
+    if (tick(this->w, WINDOW)) {
+        pthread_rwlock_wrlock(&this->scale_lock);
+        for (int i = 0; i < SK; i++)
             fprintf(fp,"%lu ", this->sketch[i]);
         fprintf(fp, "\n");
-        this->w = 0; /* Reset the timer. */
 #ifdef VIZ
 	/* If we write sketch to a file, we will also Write its
 	 * corresponding histogram to a separate file too. We
@@ -81,28 +163,35 @@ void Histogram::decay(FILE* fp) {
 	 * to one file). */
 	this->write_histogram();
 #endif
+        pthread_rwlock_unlock(&this->scale_lock);
     }
 #endif
-    this->histogram_map_lock.unlock();
 }
 
 
 /* Insert @label to the histogram if it does not exist; otherwise, update its value.
  * If @base true, we do not update hash value; we only update them during streaming.
  * We do not decay the histogram or the sketch in this function. */
-void Histogram::update(unsigned long label, bool base) {
-    this->histogram_map_lock.lock();
+template <int SK>
+void Histogram<SK>::update(unsigned long label, bool base) {
+    pthread_rwlock_rdlock(&this->scale_lock);
     /* We add the new element or update the existing element in the
      * histogram. This is done both in base and stream graph. */
-    std::pair<std::map<unsigned long, double>::iterator, bool> rst;
-    double counter = 1;
-    rst = this->histogram_map.insert(std::pair<unsigned long, double>(label, counter));
+    HistogramShard* shard = this->shard_for(label);
+    std::pair<double*, bool> rst;
+    /* Values are stored unscaled (see this->scale), so one
+     * count is 1 / scale in the stored unit. */
+    double counter = 1 / this->scale;
+    shard->lock.lock();
+    rst = shard->table.insert(label, counter);
     if (rst.second == false) {
 #ifdef DEBUG
         logstream(LOG_DEBUG) << "The label " << label << " is already in the map. Updating the sketch and its hash..." << std::endl;
 #endif
-        (rst.first)->second++;
+        *(rst.first) += counter;
     }
+    double value = *(rst.first) * this->scale;
+    shard->lock.unlock();
     /* Now we update the hash if needed.
      * Update hash only in stream graph. */
     if (!base) {
@@ -110,164 +199,180 @@ void Histogram::update(unsigned long label, bool base) {
 	 * If MEMORY is set, we use pre-sampled random variable.
 	 * This is an optimization as sampling can be slow on-the-fly. */
 #ifdef MEMORY
-	/* We use @label to decide which pre-sampled values to use
-	 * so we will always use the same values for the same label. */
-	srand(label);
-	int pos1 = rand() % PREGEN;
-	int pos2 = rand() % PREGEN;
-	for (int i = 0; i < SKETCH_SIZE; i++) {
-            /* Compute the new hash value using picked random variables. */
-            double c = this->gamma_param[pos2][i];
-	    double y = (rst.first)->second / this->r_beta_param[pos1][i];
-	    double a = c / (y * this->power_r[pos1][i]);
-            /* If the hash value is smaller than the existing value,
-	     * we replace the hash value and change the sketch value. */
-	    if (a < this->hash[i]) {
-                this->hash[i] = a;
-		this->sketch[i] = (rst.first)->first;
-	    }
-	}
+	int pos1, pos2;
+	this->param_index(label, pos1, pos2);
 #else
         /* If we do not use pre-sampled random values, we sample first
 	 * using the label and then update the hash values and sketches. */
-        struct hist_elem generated_param = this->construct_hist_elem(label);
-	for (int i = 0; i < SKETCH_SIZE; i++) {
-            /* Compute the new hash value a. */
-            double r = generated_param.r[i];
-	    double beta = generated_param.beta[i];
-	    double c = generated_param.c[i];
-	    double y = pow(M_E, log((rst.first)->second) - r * beta);
-	    double a = c / (y * pow(M_E, r));
-
-	    if (a < this->hash[i]) {
-                this->hash[i] = a;
-		this->sketch[i] = (rst.first)->first;
-            }
-	}
+        struct hist_elem<SK> generated_param = this->construct_hist_elem(label);
 #endif
+	/* Visit the stripes starting from a label-dependent one so
+	 * that concurrent updates do not all queue on stripe 0. */
+	int first_stripe = (int)(label % this->nstripes);
+	for (int k = 0; k < this->nstripes; k++) {
+	    int stripe = (first_stripe + k) % this->nstripes;
+	    int lo = stripe * SK / this->nstripes;
+	    int hi = (stripe + 1) * SK / this->nstripes;
+	    this->stripe_locks[stripe].lock();
+#ifdef MEMORY
+            /* Compute the new hash values using picked random variables
+             * and min-merge them into the sketch (see sketch_params.hpp). */
+            this->params.update_sketch(pos1, pos2, value, this->scale, label,
+                                       this->hash, this->sketch, lo, hi);
+#else
+	    for (int i = lo; i < hi; i++) {
+                /* Compute the new hash value a. */
+                double r = generated_param.r[i];
+	        double beta = generated_param.beta[i];
+	        double c = generated_param.c[i];
+	        double y = pow(M_E, log(value) - r * beta);
+	        double a = c / (y * pow(M_E, r)) / this->scale;
+                /* If the hash value is smaller than the existing value,
+	         * we replace the hash value and change the sketch value. */
+	        if (a < this->hash[i]) {
+                    this->hash[i] = a;
+		    this->sketch[i] = label;
+	        }
+	    }
+#endif
+	    this->stripe_locks[stripe].unlock();
+	}
     }
-    this->histogram_map_lock.unlock();
+    pthread_rwlock_unlock(&this->scale_lock);
     return;
 }
 
 /* Create (and initialize) a sketch after the base graph has been processed by GraphChi WL.
  * This function is called only once during initialization. If MEMORY is set to 1, we also
- * pre-sample some random values to speed up computations later. */
-void Histogram::create_sketch() {
-    this->histogram_map_lock.lock();
-#ifndef MEMORY
-    /* If we decide not to pre-sample, we can still optimize a bit by
-     * locally saving some sketch parameters for to initialize sketched. */
-    std::map<unsigned long, struct hist_elem> base_map;
-    for (std::map<unsigned long, double>::iterator it = this->histogram_map.begin(); it != this->histogram_map.end(); it++) {
-        unsigned long label = it->first;
-	struct hist_elem new_elem = this->construct_hist_elem(label);
-	base_map.insert(std::pair<unsigned long, struct hist_elem>(label, new_elem));
+ * pre-sample some random values to speed up computations later.
+ * We make a single pass over the labels: the parameters of each label are derived once
+ * and used to update all the sketch slots. Labels are split among OpenMP threads, each
+ * of which keeps its own minimum per slot; the per-thread minimums are then merged. */
+template <int SK>
+void Histogram<SK>::create_sketch() {
+    pthread_rwlock_wrlock(&this->scale_lock);
+#ifdef MEMORY
+    /* Pre-sample random variables. */
+    this->params.generate();
+#endif
+    /* Collect all (label, value) pairs of the histogram. */
+    std::vector<std::pair<unsigned long, double> > labels;
+    for (int p = 0; p < this->nshards; p++) {
+        FlatTable<double> &table = this->shards[p]->table;
+        for (size_t s = 0; s < table.slots(); s++)
+            if (table.occupied(s))
+                labels.push_back(std::pair<unsigned long, double>(table.key_at(s), table.value_at(s) * this->scale));
     }
+    assert(labels.size() > 0);
+    long nlabels = (long)labels.size();
 
-    for (int i = 0; i < SKETCH_SIZE; i++) {
-        /* Compute the hash value. */
-        std::map<unsigned long, double>::iterator histoit = this->histogram_map.begin();
-	unsigned long label = histoit->first;
-	/* First find saved local random values. */
-	std::map<unsigned long, struct hist_elem>::iterator basemapit;
-	basemapit = base_map.find(label);
-	if (basemapit == base_map.end()){
-            logstream(LOG_ERROR) << "Label: " << label << " should exist in local base map, but it does not. " << std::endl;
-	    assert(false);
+    bool found = false;
+#pragma omp parallel
+    {
+        std::vector<double> a_min(SK);
+        std::vector<unsigned long> s_min(SK);
+        bool seeded = false;
+#pragma omp for schedule(static)
+        for (long l = 0; l < nlabels; l++) {
+            unsigned long label = labels[l].first;
+            double value = labels[l].second;
+#ifdef MEMORY
+	    int pos1, pos2;
+	    this->param_index(label, pos1, pos2);
+#else
+	    struct hist_elem<SK> histo_param = this->construct_hist_elem(label);
+#endif
+	    for (int i = 0; i < SK; i++) {
+                /* Compute the hash value. */
+#ifdef MEMORY
+	        double a = this->params.hash_value(pos1, pos2, i, value);
+#else
+	        double y = pow(M_E, log(value) - histo_param.r[i] * histo_param.beta[i]);
+	        double a = histo_param.c[i] / (y * pow(M_E, histo_param.r[i]));
+#endif
+	        /* The histogram is unordered. To pick the same label as an
+	         * ordered map would on ties, we break ties by smaller label. */
+	        if (!seeded || a < a_min[i] || (a == a_min[i] && label < s_min[i])) {
+                    a_min[i] = a;
+		    s_min[i] = label;
+	        }
+	    }
+	    seeded = true;
         }
-	struct hist_elem histo_param = basemapit->second;
-	/* We use those values to compute hash. */
-	double y = pow(M_E, log(histoit->second) - histo_param.r[i] * histo_param.beta[i]);
-	double a_i = histo_param.c[i] / (y * pow(M_E, histo_param.r[i]));
-	unsigned long s_i = histoit->first;
-	for (histoit = this->histogram_map.begin(); histoit != this->histogram_map.end(); histoit++) {
-            label = histoit->first;
-	    basemapit = base_map.find(label);
-	    if (basemapit == base_map.end()){
-                logstream(LOG_ERROR) << "Label: " << label << " should exist in local base map, but it does not. " << std::endl;
-                assert(false);
-            }
-            histo_param = basemapit->second;
-	    y = pow(M_E, log(histoit->second) - histo_param.r[i] * histo_param.beta[i]);
-	    double a = histo_param.c[i] / (y * pow(M_E, histo_param.r[i])); 
-	    if (a < a_i) {
-                a_i = a;
-		s_i = histoit->first;
+	/* Merge the minimums of this thread. */
+#pragma omp critical
+        if (seeded) {
+	    for (int i = 0; i < SK; i++) {
+	        if (!found || a_min[i] < this->hash[i] || (a_min[i] == this->hash[i] && s_min[i] < this->sketch[i])) {
+                    this->hash[i] = a_min[i];
+		    this->sketch[i] = s_min[i];
+	        }
 	    }
-	}
-	this->sketch[i] = s_i;
-	this->hash[i] = a_i;
-    }
-#else
-    /* Pre-sample random variables. */
-    srand(36); /* Set a seed. */
-    for (unsigned long i = 0; i < (unsigned long)PREGEN; i++) {
-        int randomized_i = rand();
-	std::default_random_engine r_generator(randomized_i);
-	std::default_random_engine beta_generator(randomized_i);
-
-	for (int j = 0; j < SKETCH_SIZE; j++) {
-            this->gamma_param[i][j] = gamma_dist(r_generator);
-	    double uniform_param = uniform_dist(beta_generator);
-	    this->r_beta_param[i][j] = pow(M_E, this->gamma_param[i][j] * uniform_param);
-	    this->power_r[i][j] = pow(M_E, this->gamma_param[i][j]);
-	}
-	gamma_dist.reset();
+	    found = true;
+        }
     }
-    /* Initialize sketch. */
-    for (int i = 0; i < SKETCH_SIZE; i++) {
-        std::map<unsigned long, double>::iterator histoit = this->histogram_map.begin();
-	unsigned long label = histoit->first;
-
-	srand(label);
-	int pos1 = rand() % PREGEN; /* For gamma and uniform distribution. */
-	int pos2 = rand() % PREGEN; /* For the other gamma distribution. */
-
-	double y = histoit->second / this->r_beta_param[pos1][i];
-	double a_i = this->gamma_param[pos2][i] / (y * this->power_r[pos1][i]);
-	unsigned long s_i = histoit->first;
-	for (histoit = this->histogram_map.begin(); histoit != this->histogram_map.end(); histoit++) {
-            label = histoit->first;
-
-	    srand(label);
-	    pos1 = rand() % PREGEN;
-	    pos2 = rand() % PREGEN;
+    assert(found);
+    for (int i = 0; i < SK; i++)
+        this->hash[i] /= this->scale;
+    pthread_rwlock_unlock(&this->scale_lock);
+    return;
+}
 
-	    y = histoit->second / this->r_beta_param[pos1][i];
-	    double a = this->gamma_param[pos2][i] / (y * this->power_r[pos1][i]);
-	    if (a < a_i) {
-                a_i = a;
-		s_i = histoit->first;
-	    }
-	}
-	this->sketch[i] = s_i;
-	this->hash[i] = a_i;
+/* Fold the global scale factor back into the histogram
+ * values and hash values, and reset the scale to 1.
+ * The caller must hold scale_lock exclusively. */
+template <int SK>
+void Histogram<SK>::renormalize() {
+    for (int p = 0; p < this->nshards; p++) {
+        FlatTable<double> &table = this->shards[p]->table;
+        for (size_t s = 0; s < table.slots(); s++)
+            if (table.occupied(s))
+                table.value_at(s) *= this->scale;
     }
-#endif
-    this->histogram_map_lock.unlock();
+    for (int i = 0; i < SK; i++)
+        this->hash[i] *= this->scale;
+    this->scale = 1;
     return;
 }
 
 /* Write the sketch to the file @fp. */
-void Histogram::record_sketch(FILE* fp) {
-    this->histogram_map_lock.lock();
-    for (int i = 0; i < SKETCH_SIZE; i++) {
+template <int SK>
+void Histogram<SK>::record_sketch(FILE* fp) {
+    pthread_rwlock_wrlock(&this->scale_lock);
+    for (int i = 0; i < SK; i++) {
         fprintf(fp,"%lu ", this->sketch[i]);
     }
     fprintf(fp, "\n");
-    this->histogram_map_lock.unlock();
+    pthread_rwlock_unlock(&this->scale_lock);
     return;
 }
 
 /* Getter: to get the sketch. */
-unsigned long* Histogram::get_sketch() {
+template <int SK>
+unsigned long* Histogram<SK>::get_sketch() {
     return this->sketch;
 }
 
+/* All (label, value) pairs of the histogram in label order.
+ * Each shard is sorted on its own and then merged in. */
+template <int SK>
+std::vector<std::pair<unsigned long, double> > Histogram<SK>::sorted_histogram() {
+    std::vector<std::pair<unsigned long, double> > rtn;
+    for (int p = 0; p < this->nshards; p++) {
+        FlatTable<double> &table = this->shards[p]->table;
+        std::vector<size_t> sorted = table.sorted_slots();
+        size_t mid = rtn.size();
+        for (std::vector<size_t>::iterator it = sorted.begin(); it != sorted.end(); it++)
+            rtn.push_back(std::pair<unsigned long, double>(table.key_at(*it), table.value_at(*it) * this->scale));
+        std::inplace_merge(rtn.begin(), rtn.begin() + mid, rtn.end());
+    }
+    return rtn;
+}
+
 #ifdef VIZ
 /* Write the histogram to a file. */
-void Histogram::write_histogram() {
+template <int SK>
+void Histogram<SK>::write_histogram() {
     std::string hist_file_name(HIST_FILE); /* HIST_FILE is defined in def.hpp */
     hist_file_name += ".";
     hist_file_name += std::to_string(this->c);
@@ -276,9 +381,9 @@ void Histogram::write_histogram() {
     if (hfp == NULL)
         logstream(LOG_ERROR) << "Cannot open the histogram file to write: " << hist_file_name << ". Error code: " << strerror(errno) << std::endl;
     assert(hfp != NULL);
-    /* Write to the histogram file. */
-    std::map<unsigned long, double>::iterator it;
-    for (it = this->histogram_map.begin(); it != this->histogram_map.end(); it++)
+    /* Write to the histogram file, in label order. */
+    std::vector<std::pair<unsigned long, double> > sorted = this->sorted_histogram();
+    for (std::vector<std::pair<unsigned long, double> >::iterator it = sorted.begin(); it != sorted.end(); it++)
         fprintf(hfp,"%lu,%lf\n", it->first, it->second);
     fprintf(hfp, "\n");
     /* Close the file */
@@ -294,10 +399,11 @@ void Histogram::write_histogram() {
 
 #ifdef DEBUG
 /* Print the histogram map for debugging. */
-void Histogram::print_histogram() {
-    std::map<unsigned long, double>::iterator it;
+template <int SK>
+void Histogram<SK>::print_histogram() {
+    std::vector<std::pair<unsigned long, double> > sorted = this->sorted_histogram();
     logstream(LOG_DEBUG) << "Printing the histogram for debugging..." << std::endl;
-    for (it = this->histogram_map.begin(); it != this->histogram_map.end(); it++)
+    for (std::vector<std::pair<unsigned long, double> >::iterator it = sorted.begin(); it != sorted.end(); it++)
         logstream(LOG_DEBUG) << "[" << it->first << "]->" << it->second << "  ";
     logstream(LOG_DEBUG) << "\n";
     return;
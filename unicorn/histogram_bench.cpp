@@ -0,0 +1,111 @@
+/*
+ *
+ * Author: Xueyuan Han <hanx@g.harvard.edu>
+ *
+ * Copyright (C) 2018-2020 Harvard University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ */
+
+/* Thread-scaling benchmark of Histogram::update.
+ * It mimics what WL does during streaming: every
+ * thread calls decay() and then update() on a stream
+ * of labels. We report update throughput for 1, 2,
+ * 4, ... threads, so that the effect of hist_shards
+ * on contention can be measured in isolation. */
+
+#ifndef SKETCH_SIZE
+#error "histogram_bench must be compiled with -DSKETCH_SIZE=<SIZE>"
+#endif
+
+#include <chrono>
+#include <thread>
+#include <vector>
+/* NOTE: helper.hpp must be included first. */
+#include "include/helper.hpp"
+#include "include/def.hpp"
+#include "include/histogram.hpp"
+/* GraphChi header files we use. */
+#include "graphchi_basic_includes.hpp"
+#include "logger/logger.hpp"
+
+using namespace graphchi;
+
+/* The following variables are declared in def.hpp. */
+int DECAY;
+float LAMBDA;
+bool LAZY_DECAY = false;
+int HIST_SHARDS;
+bool COUNTER_RNG = false;
+int WINDOW;
+int BATCH;
+bool CHUNKIFY = true;
+int CHUNK_SIZE;
+bool BINARY_RELABEL = false;
+int RADIX_THRESHOLD;
+FILE * SFP;
+#ifdef VIZ
+std::string HIST_FILE;
+#endif
+
+/* Labels in Unicorn are hash values; we scramble
+ * the index so that labels look alike. */
+static unsigned long bench_label(unsigned long i) {
+    unsigned long h = (i + 1) * 0x9E3779B97F4A7C15UL;
+    h ^= h >> 32;
+    return h;
+}
+
+static void run_updates(Histogram<SKETCH_SIZE>* hist, int tid, int nthreads, long nupdates, long nlabels) {
+    for (long i = tid; i < nupdates; i += nthreads) {
+        hist->decay(SFP);
+        hist->update(bench_label((unsigned long)(i * 7919) % nlabels), false);
+    }
+}
+
+int main(int argc, const char ** argv) {
+    graphchi_init(argc, argv);
+    global_logger().set_log_level(LOG_INFO);
+
+    int max_threads = get_option_int("threads", (int)std::thread::hardware_concurrency());
+    long nupdates = get_option_long("updates", 200000);
+    long nlabels = get_option_long("labels", 10000);
+    DECAY = get_option_int("decay", 10);
+    LAMBDA = get_option_float("lambda", 0.02);
+    int to_lazy_decay = get_option_int("lazy_decay", 0);
+    if (to_lazy_decay) LAZY_DECAY = true;
+    HIST_SHARDS = get_option_int("hist_shards", 1);
+    std::string param_rng = get_option_string("param_rng", "libc");
+    if (param_rng == "counter") COUNTER_RNG = true;
+    else if (param_rng != "libc") {
+        logstream(LOG_ERROR) << "Unknown param_rng: " << param_rng << ". Use libc or counter." << std::endl;
+        assert(false);
+    }
+    WINDOW = get_option_int("window", 500);
+    SFP = fopen("/dev/null", "w");
+    assert(SFP != NULL);
+
+    /* Build the base histogram and its sketch. */
+    Histogram<SKETCH_SIZE>* hist = Histogram<SKETCH_SIZE>::get_instance();
+    for (long i = 0; i < nlabels; i++)
+        hist->update(bench_label(i), true);
+    hist->create_sketch();
+
+    for (int nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int tid = 0; tid < nthreads; tid++)
+            workers.push_back(std::thread(run_updates, hist, tid, nthreads, nupdates, nlabels));
+        for (size_t tid = 0; tid < workers.size(); tid++)
+            workers[tid].join();
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        logstream(LOG_INFO) << "hist_shards " << HIST_SHARDS << " threads " << nthreads
+                            << ": " << (long)(nupdates / secs) << " updates/sec" << std::endl;
+    }
+    fclose(SFP);
+    return 0;
+}
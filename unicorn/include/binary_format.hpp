@@ -0,0 +1,159 @@
+/*
+ *
+ * Author: Xueyuan Han <hanx@g.harvard.edu>
+ *
+ * Copyright (C) 2018-2020 Harvard University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ */
+#ifndef __BINARY_FORMAT_HPP__
+#define __BINARY_FORMAT_HPP__
+
+#include <cassert>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+/* GraphChi header files. */
+#include "graphchi_types.hpp"
+#include "logger/logger.hpp"
+#include "preprocessing/conversions.hpp"
+/* Unicorn header files. */
+#include "def.hpp"
+#include "stream_reader.hpp"
+
+/* A pre-parsed binary format for base and stream graph files,
+ * so that replaying a graph does not parse text or hash label
+ * strings again. bin/unicorn/binconvert converts text files.
+ * A file is a binary_header followed by fixed-size
+ * binary_records. Labels are stored already hashed; the header
+ * records which hash function was used, so that we never mix
+ * labels hashed in different ways. Binary files are detected
+ * by their magic, so they are used wherever a text file is. */
+#define BINARY_MAGIC "UNCRNBIN"
+#define BINARY_VERSION 1
+/* hash() in helper.hpp (DJB). */
+#define BINARY_HASH_DJB 1
+
+/* What a binary file holds. Base graph records do not use new_src and new_dst. */
+#define BINARY_KIND_BASE 0
+#define BINARY_KIND_STREAM 1
+
+struct binary_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t hash_scheme;
+    uint32_t kind;
+    uint32_t record_size;
+};
+
+struct binary_record {
+    uint32_t src;	/* Source node ID. */
+    uint32_t dst;	/* Destination node ID. */
+    uint64_t src_label;
+    uint64_t dst_label;
+    uint64_t edge_label;
+    uint64_t time;
+    uint8_t new_src;
+    uint8_t new_dst;
+    uint8_t pad[6];
+};
+
+static inline void init_binary_header(binary_header* h, uint32_t kind) {
+    memset(h, 0, sizeof(binary_header));
+    memcpy(h->magic, BINARY_MAGIC, sizeof(h->magic));
+    h->version = BINARY_VERSION;
+    h->hash_scheme = BINARY_HASH_DJB;
+    h->kind = kind;
+    h->record_size = sizeof(binary_record);
+}
+
+/* If @reader starts with a binary header, check that we can
+ * read it as a file of @kind, consume it and return true.
+ * We look at the first byte alone first, so that we do not
+ * wait for a whole header from a live text source. */
+static bool read_binary_header(StreamReader* reader, uint32_t kind) {
+    const char* p;
+    if (!reader->peek(&p, 1) || *p != BINARY_MAGIC[0])
+        return false;
+    if (!reader->peek(&p, sizeof(binary_header)) || memcmp(p, BINARY_MAGIC, 8) != 0)
+        return false;
+    binary_header h;
+    memcpy(&h, p, sizeof(h));
+    if (h.version != BINARY_VERSION || h.record_size != sizeof(binary_record)) {
+        logstream(LOG_ERROR) << "Unsupported binary graph file version " << h.version
+                             << " (record size " << h.record_size << ")." << std::endl;
+        assert(false);
+    }
+    if (h.hash_scheme != BINARY_HASH_DJB) {
+        logstream(LOG_ERROR) << "Binary graph file labels were hashed with unknown scheme " << h.hash_scheme << "." << std::endl;
+        assert(false);
+    }
+    if (h.kind != kind) {
+        logstream(LOG_ERROR) << "Binary graph file holds a " << (h.kind == BINARY_KIND_BASE ? "base" : "stream")
+                             << " graph, but a " << (kind == BINARY_KIND_BASE ? "base" : "stream") << " graph is expected." << std::endl;
+        assert(false);
+    }
+    reader->skip(sizeof(binary_header));
+    return true;
+}
+
+/* Populate an edge from a record, as parse() and
+ * parse_stream_edge() do from a line of text. */
+template <int KH>
+static inline void binary_record_to_edge(const char* p, graphchi::vid_t &src, graphchi::vid_t &dst, edge_label<KH> &e) {
+    binary_record r;
+    memcpy(&r, p, sizeof(r));
+    src = r.src;
+    dst = r.dst;
+    e.itr = 0;
+    e.new_src = r.new_src == 1;
+    e.new_dst = r.new_dst == 1;
+    e.set_src(0, r.src_label);
+    e.set_dst(r.dst_label);
+    e.set_edg(r.edge_label);
+    e.set_tme(0, r.time);
+}
+
+/* Shard the base graph if it is not sharded yet. A binary base
+ * graph is fed to the sharder directly; anything else goes
+ * through GraphChi (using the filetype option). */
+template <int KH>
+int convert_base_if_notexists(std::string base_file, std::string nshards_string) {
+    StreamReader reader(base_file);
+    if (!read_binary_header(&reader, BINARY_KIND_BASE)) {
+        reader.close();
+        return graphchi::convert_if_notexists<edge_label<KH> >(base_file, nshards_string);
+    }
+    int nshards = graphchi::find_shards<edge_label<KH> >(base_file, nshards_string);
+    if (nshards && graphchi::check_origfile_modification_earlier<edge_label<KH> >(base_file, nshards)) {
+        logstream(LOG_INFO) << "Found preprocessed files for " << base_file << ", num shards=" << nshards << std::endl;
+        return nshards;
+    }
+    logstream(LOG_INFO) << "Sharding binary base graph " << base_file << std::endl;
+    graphchi::sharder<edge_label<KH> > sharderobj(base_file);
+    sharderobj.start_preprocessing();
+    const char* chunk;
+    size_t len;
+    while (reader.next_records(&chunk, &len, STREAM_BLOCK_SIZE, sizeof(binary_record))) {
+        for (size_t i = 0; i < len; i += sizeof(binary_record)) {
+            graphchi::vid_t from, to;
+            edge_label<KH> e = edge_label<KH>();
+            binary_record_to_edge(chunk + i, from, to, e);
+            /* The sharder drops self-loops, as with text files. */
+            sharderobj.preprocessing_add_edge(from, to, e);
+        }
+    }
+    sharderobj.end_preprocessing();
+    graphchi::vid_t max_vertex_id = graphchi::get_option_int("maxvertex", 0);
+    if (max_vertex_id > 0)
+        sharderobj.set_max_vertex_id(max_vertex_id);
+    nshards = sharderobj.execute_sharding(nshards_string);
+    logstream(LOG_INFO) << "Created " << nshards << " shards." << std::endl;
+    return nshards;
+}
+
+#endif /* __BINARY_FORMAT_HPP__ */
@@ -0,0 +1,55 @@
+/*
+ *
+ * Author: Xueyuan Han <hanx@g.harvard.edu>
+ *
+ * Copyright (C) 2018-2020 Harvard University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ */
+#ifndef __COUNTER_RNG_HPP__
+#define __COUNTER_RNG_HPP__
+
+#include <cmath>
+#include <stdint.h>
+
+/* A stateless (counter-based) random number generator.
+ * The n-th random number of stream @key is a SplitMix64
+ * mix of (key, n), so it can be computed on the fly from
+ * any thread without keeping (or locking) any state. It
+ * is used in COUNTER_RNG mode to derive sketch parameters
+ * from labels. */
+
+/* SplitMix64 finalizer (Steele et al., "Fast Splittable
+ * Pseudorandom Number Generators", OOPSLA 2014). */
+static inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/* The @n-th 64-bit random number of stream @key. */
+static inline uint64_t counter_hash(uint64_t key, uint64_t n) {
+    return splitmix64(splitmix64(key) ^ (n * 0xD1B54A32D192ED03ULL));
+}
+
+/* Uniform double in (0, 1]; never 0 so that it is safe to take its log. */
+static inline double counter_uniform(uint64_t key, uint64_t n) {
+    return ((counter_hash(key, n) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+/* Gamma(2, 1) is the sum of two Exp(1), i.e., -ln(u1 * u2). */
+static inline double counter_gamma2(uint64_t key, uint64_t n) {
+    return -log(counter_uniform(key, 2 * n) * counter_uniform(key, 2 * n + 1));
+}
+
+/* Map a 32-bit random number to [0, range) without division. */
+static inline int counter_range(uint32_t x, int range) {
+    return (int)(((uint64_t)x * (uint64_t)range) >> 32);
+}
+
+#endif /* __COUNTER_RNG_HPP__ */
@@ -19,15 +19,37 @@
 #include <cmath>
 #include <pthread.h> 
 #include <string>
+#ifdef COMPACT_EDGES
+#include "label_dict.hpp"
+#endif
 
-/* NOTE: SKETCH_SIZE and K_HOPS are compilation
- * constant defined using -D flags. */
+/* NOTE: the sketch size and the number of hops (K_HOPS)
+ * are template parameters (SK and KH) of the data types
+ * and classes below. main.cpp instantiates a fixed set of
+ * combinations and picks one using the sketch_size and
+ * k_hops command line options. If SKETCH_SIZE and K_HOPS
+ * are defined using -D flags, only that combination is
+ * compiled. */
 
 /* The value of items in the histogram
  * will decay every DECAY updates. */
 extern int DECAY;
 /* The rate of the decay. */
 extern float LAMBDA;
+/* If set, decay is lazy: instead of walking every
+ * histogram value and hash value, we keep a global
+ * scale factor that we multiply by e^(-lambda), so
+ * each decay costs O(1). */
+extern bool LAZY_DECAY;
+/* Number of independently locked partitions
+ * of the histogram, so that WL updates from
+ * different threads rarely contend. */
+extern int HIST_SHARDS;
+/* If set, sketch parameters of a label are derived
+ * from a stateless counter-based hash of the label
+ * instead of seeding libc's rand() with the label.
+ * Sketches differ from the default (libc) mode. */
+extern bool COUNTER_RNG;
 /* We see WINDOW node updates before
  * we record a new graph sketch (if
  * BATCH is not used to determine
@@ -43,6 +65,14 @@ extern int BATCH;
  * and how big each chunk is. CHUNK_SIZE > 1 */
 extern bool CHUNKIFY;
 extern int CHUNK_SIZE;
+/* If set, WL relabels a vertex by hashing its
+ * 64-bit neighborhood labels directly instead
+ * of hashing their decimal string. The labels
+ * (and thus sketches) differ from string mode. */
+extern bool BINARY_RELABEL;
+/* If > 0, WL radix-sorts neighborhoods of at
+ * least RADIX_THRESHOLD in-coming edges. */
+extern int RADIX_THRESHOLD;
 /* Sketch file to write the sketch. */
 extern FILE * SFP;
 #ifdef VIZ
@@ -54,7 +84,7 @@ extern std::string HIST_FILE;
 
 /* In a streaming setting, GraphChi does not allow dynamic vertex/edge type.
  * We therefore must fixed the neighborhood we are exploring.
- * Currently we implement K_HOPS neighborhood.
+ * Currently we implement K_HOPS (KH) neighborhood.
  * Therefore, The array "src" holds K_HOPS + 1 elements:
  * - The label of the source node, which we can initialize from the file.
  * - The relabel of the first-hop neighborhood.
@@ -70,39 +100,88 @@ extern std::string HIST_FILE;
  * For streaming new edges:
  * - "new_src": whether the source node is new, never-before-seen.
  * - "new_dst": whether the destination node is new. never-before-seen.
+ * Code should use the get_/set_ accessors for labels and timestamps,
+ * since their representation depends on COMPACT_EDGES:
+ * - By default, labels and timestamps are 64-bit values.
+ * - With COMPACT_EDGES, the labels read from the graph (src[0],
+ *   "dst" and "edg") are 32-bit IDs interned in the LabelDictionary,
+ *   and "itr", "new_src" and "new_dst" are packed into one 32-bit
+ *   word. The relabels and timestamps stay 64-bit values in the
+ *   edge, since WL creates new ones in every hop of every batch.
+ *   This cuts the size of an edge (e.g., from 88 to 72 bytes when
+ *   K_HOPS is 3), and thus the shard I/O, at the cost of a dictionary
+ *   lookup when reading a graph label.
  */
-typedef struct edge_label {
+#ifndef COMPACT_EDGES
+template <int KH>
+struct edge_label {
     /* We use K_HOPS+1 because the first element is itself and
      * the next K_HOPS are exploration of K_HOPS neighbors. */
-    unsigned long src[K_HOPS+1];
-    unsigned long tme[K_HOPS+1];
+    unsigned long src[KH+1];
+    unsigned long tme[KH+1];
     unsigned long dst;
     unsigned long edg;
     int itr;
     bool new_src;
     bool new_dst;
-} EdgeDataType;
+
+    inline unsigned long get_src(int i) const { return this->src[i]; }
+    inline void set_src(int i, unsigned long label) { this->src[i] = label; }
+    inline unsigned long get_tme(int i) const { return this->tme[i]; }
+    inline void set_tme(int i, unsigned long t) { this->tme[i] = t; }
+    inline unsigned long get_dst() const { return this->dst; }
+    inline void set_dst(unsigned long label) { this->dst = label; }
+    inline unsigned long get_edg() const { return this->edg; }
+    inline void set_edg(unsigned long label) { this->edg = label; }
+};
+#else
+template <int KH>
+struct edge_label {
+    unsigned long rel[KH];	/* src[1] to src[KH]. */
+    unsigned long tme[KH+1];
+    uint32_t src;		/* Label ID of src[0]. */
+    uint32_t dst;		/* Label ID. */
+    uint32_t edg;		/* Label ID. */
+    unsigned int itr : 30;
+    unsigned int new_src : 1;
+    unsigned int new_dst : 1;
+
+    inline unsigned long get_src(int i) const {
+        return i == 0 ? LabelDictionary::get_instance()->label(this->src) : this->rel[i - 1];
+    }
+    inline void set_src(int i, unsigned long label) {
+        if (i == 0)
+            this->src = LabelDictionary::get_instance()->intern(label);
+        else
+            this->rel[i - 1] = label;
+    }
+    inline unsigned long get_tme(int i) const { return this->tme[i]; }
+    inline void set_tme(int i, unsigned long t) { this->tme[i] = t; }
+    inline unsigned long get_dst() const { return LabelDictionary::get_instance()->label(this->dst); }
+    inline void set_dst(unsigned long label) { this->dst = LabelDictionary::get_instance()->intern(label); }
+    inline unsigned long get_edg() const { return LabelDictionary::get_instance()->label(this->edg); }
+    inline void set_edg(unsigned long label) { this->edg = LabelDictionary::get_instance()->intern(label); }
+};
+#endif
 
 /* Node remembers all its most-updated labels "lb" and timestamps "tm".
  * "is_leaf" is whether the node is a leaf node (i.e., no incoming edges). */
-typedef struct node_label {
-    unsigned long lb[K_HOPS+1];
-    unsigned long tm[K_HOPS+1];
+template <int KH>
+struct node_label {
+    unsigned long lb[KH+1];
+    unsigned long tm[KH+1];
     bool is_leaf;
-} VertexDataType;
+};
 
 /* Each histogram element is associated with r, beta, c, which
  * are parameters to create hash values. r ~ Gamma(2, 1),
  * c ~ Gamma(2, 1), beta ~ Uniform(0, 1)
  * Reference: https://doc.rero.ch/record/309000/files/cud_hsf.pdf
  */
+template <int SK>
 struct hist_elem {
-    double r[SKETCH_SIZE];
-    double beta[SKETCH_SIZE];
-    double c[SKETCH_SIZE]; 
+    double r[SK];
+    double beta[SK];
+    double c[SK]; 
 };
-/* Distribution used in locality-sensitive hashing. */
-std::gamma_distribution<double> gamma_dist(2.0, 1.0);
-std::uniform_real_distribution<double> uniform_dist(0.0, 1.0);
-
 #endif /* __DEF_HPP__ */
@@ -0,0 +1,208 @@
+/*
+ *
+ * Author: Xueyuan Han <hanx@g.harvard.edu>
+ *
+ * Copyright (C) 2018-2020 Harvard University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ */
+#ifndef __FLAT_TABLE_HPP__
+#define __FLAT_TABLE_HPP__
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+/* An open-addressing hash table keyed by 64-bit labels.
+ * Keys and values are stored in two separate flat arrays
+ * (structure of arrays) and collisions are resolved by
+ * linear probing, so both lookups and full scans touch
+ * contiguous memory instead of chasing tree pointers.
+ * Key 0 marks an empty slot; the (rare) label 0 is kept
+ * in one extra slot at the end of the arrays, at index
+ * capacity(). Slots are therefore numbered 0..slots()-1
+ * and can be scanned (even in parallel) by index. Note
+ * that growing the table invalidates value pointers. */
+template <typename V>
+class FlatTable {
+public:
+    FlatTable(size_t initial_capacity = 1024) {
+        size_t cap = 16;
+        while (cap < initial_capacity)
+            cap <<= 1;
+        this->keys = NULL;
+        this->values = NULL;
+        this->allocate(cap);
+    }
+
+    ~FlatTable() {
+        free(this->keys);
+        free(this->values);
+    }
+
+    /* Insert @key with @value if @key does not exist.
+     * Returns the pointer to the value of @key and
+     * whether the key is newly inserted. */
+    std::pair<V*, bool> insert(unsigned long key, V value) {
+        if (key == 0) {
+            bool inserted = !this->has_zero;
+            if (inserted) {
+                this->values[this->cap] = value;
+                this->has_zero = true;
+                this->count++;
+            }
+            return std::pair<V*, bool>(&this->values[this->cap], inserted);
+        }
+        if ((this->count + 1) * 10 > this->cap * 7)
+            this->grow();
+        size_t pos = this->home(key);
+        while (this->keys[pos] != 0) {
+            if (this->keys[pos] == key)
+                return std::pair<V*, bool>(&this->values[pos], false);
+            pos = (pos + 1) & this->mask;
+        }
+        this->keys[pos] = key;
+        this->values[pos] = value;
+        this->count++;
+        return std::pair<V*, bool>(&this->values[pos], true);
+    }
+
+    /* Returns the pointer to the value of @key or NULL. */
+    V* find(unsigned long key) {
+        if (key == 0)
+            return this->has_zero ? &this->values[this->cap] : NULL;
+        size_t pos = this->home(key);
+        while (this->keys[pos] != 0) {
+            if (this->keys[pos] == key)
+                return &this->values[pos];
+            pos = (pos + 1) & this->mask;
+        }
+        return NULL;
+    }
+
+    size_t size() const {
+        return this->count;
+    }
+
+    size_t capacity() const {
+        return this->cap;
+    }
+
+    /* Number of slots to scan by index (including the slot for key 0). */
+    size_t slots() const {
+        return this->cap + 1;
+    }
+
+    bool occupied(size_t i) const {
+        return i < this->cap ? this->keys[i] != 0 : this->has_zero;
+    }
+
+    unsigned long key_at(size_t i) const {
+        return i < this->cap ? this->keys[i] : 0;
+    }
+
+    V& value_at(size_t i) {
+        return this->values[i];
+    }
+
+    /* Indices of all occupied slots, ordered by key.
+     * Used when the output must be in label order. */
+    std::vector<size_t> sorted_slots() const {
+        std::vector<size_t> rtn;
+        rtn.reserve(this->count);
+        if (this->has_zero)
+            rtn.push_back(this->cap);
+        for (size_t i = 0; i < this->cap; i++)
+            if (this->keys[i] != 0)
+                rtn.push_back(i);
+        std::sort(rtn.begin(), rtn.end(), SlotSorter(this));
+        return rtn;
+    }
+
+    void clear() {
+        memset(this->keys, 0, sizeof(unsigned long) * this->cap);
+        this->has_zero = false;
+        this->count = 0;
+    }
+
+private:
+    /* Order slot indices by the key they hold. */
+    class SlotSorter {
+        const FlatTable* table;
+
+        public:
+            SlotSorter(const FlatTable* table) {
+                this->table = table;
+            }
+
+            bool operator()(size_t a, size_t b) const {
+                return this->table->key_at(a) < this->table->key_at(b);
+            }
+    };
+
+    /* Labels are already hashes, but their low bits are not well
+     * mixed (DJB), so we take the high bits of a Fibonacci hash. */
+    inline size_t home(unsigned long key) const {
+        return (size_t)((key * 0x9E3779B97F4A7C15UL) >> this->shift);
+    }
+
+    void allocate(size_t cap) {
+        this->cap = cap;
+        this->mask = cap - 1;
+        this->shift = 64;
+        for (size_t c = cap; c > 1; c >>= 1)
+            this->shift--;
+        this->keys = (unsigned long*)calloc(cap, sizeof(unsigned long));
+        this->values = (V*)malloc((cap + 1) * sizeof(V));
+        assert(this->keys != NULL && this->values != NULL);
+        this->has_zero = false;
+        this->count = 0;
+    }
+
+    /* Double the capacity and re-insert all keys. */
+    void grow() {
+        unsigned long* old_keys = this->keys;
+        V* old_values = this->values;
+        size_t old_cap = this->cap;
+        bool old_has_zero = this->has_zero;
+        size_t old_count = this->count;
+
+        this->allocate(old_cap * 2);
+        for (size_t i = 0; i < old_cap; i++) {
+            if (old_keys[i] == 0)
+                continue;
+            size_t pos = this->home(old_keys[i]);
+            while (this->keys[pos] != 0)
+                pos = (pos + 1) & this->mask;
+            this->keys[pos] = old_keys[i];
+            this->values[pos] = old_values[i];
+        }
+        if (old_has_zero)
+            this->values[this->cap] = old_values[old_cap];
+        this->has_zero = old_has_zero;
+        this->count = old_count;
+        free(old_keys);
+        free(old_values);
+    }
+
+    unsigned long* keys;
+    V* values;
+    size_t cap;   /* Always a power of 2. */
+    size_t mask;
+    int shift;
+    size_t count;
+    bool has_zero;
+
+    /* Disable value copying. */
+    FlatTable(const FlatTable&);
+    FlatTable& operator=(const FlatTable&);
+};
+
+#endif /* __FLAT_TABLE_HPP__ */
@@ -13,6 +13,7 @@
 #ifndef __HELPER_HPP__
 #define __HELPER_HPP__
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
@@ -20,9 +21,12 @@
 #include <unistd.h>
 #include <vector>
 /* Header file from GraphChi. */
+#include "graphchi_types.hpp"
 #include "logger/logger.hpp"
+#include "util/radixSort.hpp"
 /* Header file from Unicorn. */
 #include "def.hpp"
+#include "counter_rng.hpp"
 
 namespace graphchi {
     /* Deterministically hash character strings to
@@ -36,9 +40,164 @@ namespace graphchi {
         return hash;
     }
 
+    /* The same hash of the @len characters at @str, which
+     * do not have to be NUL-terminated. */
+    unsigned long hash(const char *str, size_t len) {
+        unsigned long hash = 5381;
+        for (size_t i = 0; i < len; i++)
+            hash = ((hash << 5) + hash) + (unsigned char)str[i]; /* hash * 33 + c */
+        return hash;
+    }
+
+    /* Splits [begin, end) into tokens separated by any number of
+     * ':', '\t' or ' ' (as strtok does), without modifying it. */
+    class LineTokenizer {
+        const char *p;
+        const char *end;
+
+        static inline bool is_delim(char c) {
+            return c == ':' || c == '\t' || c == ' ';
+        }
+
+        public:
+            LineTokenizer(const char *begin, size_t len) {
+                this->p = begin;
+                this->end = begin + len;
+            }
+
+            /* Set @tok and @len to the next token. Returns false if there is none. */
+            bool next(const char **tok, size_t *len) {
+                while (this->p < this->end && is_delim(*this->p))
+                    this->p++;
+                if (this->p == this->end)
+                    return false;
+                *tok = this->p;
+                while (this->p < this->end && !is_delim(*this->p))
+                    this->p++;
+                *len = this->p - *tok;
+                return true;
+            }
+    };
+
+    /* Parse the leading decimal digits of a token (with an
+     * optional sign), like strtoul does with base 10. */
+    unsigned long parse_ulong(const char *s, size_t len) {
+        size_t i = 0;
+        bool negative = false;
+        if (i < len && (s[i] == '+' || s[i] == '-'))
+            negative = s[i++] == '-';
+        unsigned long v = 0;
+        for (; i < len && s[i] >= '0' && s[i] <= '9'; i++)
+            v = v * 10 + (s[i] - '0');
+        return negative ? -v : v;
+    }
+
+    /* Hash a sequence of 64-bit labels (used by the binary
+     * relabel mode instead of hashing a decimal string).
+     * Every label goes through the SplitMix64 mixer, so
+     * the result depends on all bits and on the order of
+     * the labels; the length is mixed in at the end. */
+    class LabelHasher {
+        unsigned long h;
+        unsigned long n;
+
+        public:
+            LabelHasher() {
+                this->reset();
+            }
+
+            void reset() {
+                this->h = 5381;
+                this->n = 0;
+            }
+
+            void add(unsigned long label) {
+                this->h = splitmix64(this->h ^ label);
+                this->n++;
+            }
+
+            unsigned long count() const {
+                return this->n;
+            }
+
+            unsigned long value() const {
+                return splitmix64(this->h ^ this->n);
+            }
+    };
+
+    /* Parse a line of the stream graph file:
+     * <src ID> <dst ID> <src label>:<dst label>:<edge label>:<new_src>:<new_dst>:<time>
+     * into @src, @dst and @e. The line does not need to be
+     * NUL-terminated and we do not modify it. */
+    template <int KH>
+    void parse_stream_edge(const char *line, size_t len, vid_t &src, vid_t &dst, edge_label<KH> &e) {
+        LineTokenizer tokens(line, len);
+        const char *t;
+        size_t n;
+        bool found;
+
+	/* Obtain source node ID. */
+        found = tokens.next(&t, &n);
+        if (!found)
+            logstream(LOG_ERROR) << "Source ID is missing." << std::endl;
+        assert(found);
+        src = (vid_t)parse_ulong(t, n);
+
+	/* Obtain destination node ID. */
+        found = tokens.next(&t, &n);
+        if (!found)
+            logstream(LOG_ERROR) << "Destination ID is missing." << std::endl;
+        assert(found);
+        dst = (vid_t)parse_ulong(t, n);
+
+	/* Populate EdgeDataType for the edge. */
+        e.itr = 0; /* new itr count is always 0. */
+        found = tokens.next(&t, &n);
+        if (!found)
+            logstream(LOG_ERROR) << "Source label is missing." << std::endl;
+        assert(found);
+        e.set_src(0, hash(t, n));
+
+        found = tokens.next(&t, &n);
+        if (!found)
+            logstream(LOG_ERROR) << "Destination label is missing." << std::endl;
+        assert(found);
+        e.set_dst(hash(t, n));
+
+        found = tokens.next(&t, &n);
+        if (!found)
+            logstream(LOG_ERROR) << "Edge label is missing." << std::endl;
+        assert(found);
+        e.set_edg(hash(t, n));
+
+        found = tokens.next(&t, &n);
+        if (!found)
+            logstream(LOG_ERROR) << "New_src info is missing." << std::endl;
+        assert(found);
+        e.new_src = parse_ulong(t, n) == 1;
+
+        found = tokens.next(&t, &n);
+        if (!found)
+            logstream(LOG_ERROR) << "New_dst info is missing." << std::endl;
+        assert(found);
+        e.new_dst = parse_ulong(t, n) == 1;
+
+        found = tokens.next(&t, &n);
+        if (!found)
+            logstream(LOG_ERROR) << "Time is missing." << std::endl;
+        assert(found);
+        e.set_tme(0, parse_ulong(t, n));
+
+#ifdef DEBUG
+        if (tokens.next(&t, &n))
+            logstream(LOG_DEBUG) << "Extra info in the edge is ignored." << std::endl;
+#endif
+    }
+
     /* Customized parse function to parse edge labels
      * from edgelist-formatted file (for base graph). */
-    void parse(EdgeDataType &e, const char *s) {
+    template <int KH>
+    void parse(edge_label<KH> &e, const char *s) {
         char *ss = (char *) s;
         char delims[] = ":";
         unsigned char *t;
@@ -54,25 +213,25 @@ namespace graphchi {
         if (t == NULL)
             logstream(LOG_ERROR) << "Source label is missing." << std::endl;
         assert(t != NULL);
-        e.src[0] = hash(t);
+        e.set_src(0, hash(t));
 
         t = (unsigned char *)strtok(NULL, delims);
         if (t == NULL)
             logstream(LOG_ERROR) << "Destination label does is missing." << std::endl;
         assert (t != NULL);
-        e.dst = hash(t);
+        e.set_dst(hash(t));
 
         t = (unsigned char *)strtok(NULL, delims);
         if (t == NULL)
             logstream(LOG_ERROR) << "Edge label is missing." << std::endl;
         assert (t != NULL);
-        e.edg = hash(t);
+        e.set_edg(hash(t));
 
         k = strtok(NULL, delims);
         if (k == NULL)
             logstream(LOG_ERROR) << "Timestamp is missing." << std::endl;
         assert (k != NULL);
-        e.tme[0] = std::strtoul(k, NULL, 10);
+        e.set_tme(0, std::strtoul(k, NULL, 10));
 #ifdef DEBUG
         k = strtok(NULL, delims);
         if (k != NULL)
@@ -82,77 +241,151 @@ namespace graphchi {
         return;
     }
 
-    /* Chunk a string into a vector of hashed 
-     * substrings (hashed to unsigned long)
-     * to be inserted into the histogram. */
-    std::vector<unsigned long> chunkify(unsigned char *s, int chunk_size) {
-        char *ss = (char *) s;
-        char delims[] = " ";
-        char *t;
-        int counter = 0;
-        std::string to_hash = "";
-        std::vector<unsigned long> rtn;
-        bool first = true;
+    /* Hash the space-separated string of decimal labels that
+     * the string relabel mode builds, one label at a time and
+     * without building the string. value() is the same as
+     * hash() of the whole string. If @chunk_size > 0, the hash
+     * of every chunk of the string is also appended to @chunks.
+     * We explain the chunks using an example.
+     * If we have a string: 12334 456 76634 4546 2345, and chunk_size is set to 2.
+     * We produce the following substrings:
+     * 1. 12334 456
+     * 2.  76634 4546
+     * 3.  2345
+     * Note that there is a space in the front of substring 2 and substring 3.
+     * @chunk_size is the maximum size of the chunk. Note that substring 3 has only 1 string.
+     * Each chunk is hashed as hash() would hash the substring. */
+    class StringLabelHasher {
+        unsigned long h;
+        unsigned long chunk_h;
+        int nlabels;
+        int chunk_size;
+        std::vector<unsigned long>* chunks;
+#ifdef DEBUG
+        std::string str;
+#endif
 
-        /* chunk_size must be larger than 1. */
-        assert(chunk_size > 1);
+        /* DJB step for one character; see hash(). */
+        inline void add_char(unsigned char c) {
+            this->h = ((this->h << 5) + this->h) + c;
+            this->chunk_h = ((this->chunk_h << 5) + this->chunk_h) + c;
+#ifdef DEBUG
+            this->str += c;
+#endif
+        }
 
-        t = strtok(ss, delims);
-        if (t == NULL)
-            logstream(LOG_ERROR) << "The string to be chunked must be non-empty." << std::endl;
-        assert(t != NULL);
+        public:
+            StringLabelHasher(int chunk_size, std::vector<unsigned long>* chunks) {
+                /* chunk_size must be larger than 1 if we chunk. */
+                assert(chunk_size == 0 || (chunk_size > 1 && chunks != NULL));
+                this->h = 5381;
+                this->chunk_h = 5381;
+                this->nlabels = 0;
+                this->chunk_size = chunk_size;
+                this->chunks = chunks;
+            }
 
-        /* We explain the following logic using an example.
-         * If we have a string: 12334 456 76634 4546 2345, and chunk_size is set to 2.
-         * We produce the following substrings:
-         * 1. 12334 45
-         * 2.  76634 4546
-         * 3.  2345
-         * Note that there is a space in the front of substring 2 and substring 3.
-         * @chunk_size is the maximum size of the chunk. Note that substring 3 has only 1 string.
-         * We hash each substring and push it into the vector to return. */
-        while (t != NULL) {
-            std::string str(t);
-            if (first) {
-                to_hash += str;
-                first = false;
-            } else
-                to_hash += " " + str;
-            counter++;
-            if (counter == chunk_size) {
-                rtn.push_back(hash((unsigned char *)to_hash.c_str()));
-                counter = 0;
-                to_hash = "";
+            void add(unsigned long label) {
+                if (this->nlabels > 0) {
+                    /* A new chunk starts before the space. */
+                    if (this->chunk_size > 0 && this->nlabels % this->chunk_size == 0) {
+                        this->chunks->push_back(this->chunk_h);
+                        this->chunk_h = 5381;
+                    }
+                    this->add_char(' ');
+                }
+                /* Print the label in decimal. */
+                char digits[20];
+                int n = 0;
+                do {
+                    digits[n++] = '0' + label % 10;
+                    label /= 10;
+                } while (label > 0);
+                while (n > 0)
+                    this->add_char(digits[--n]);
+                this->nlabels++;
             }
-            t = strtok(NULL, delims);
-        }
-        /* Handle the leftover (last substring) that might be < chunk_size. */
-        if (to_hash.length() > 0) {
-            rtn.push_back(hash((unsigned char *)to_hash.c_str()));
-        }
-        return rtn;
-    }
 
-    /* Compare two edges based on one of the timestamp specified by @pos.
-     * This function is used to sort the edges. */
-    bool compareEdges(EdgeDataType a, EdgeDataType b, int pos) {
-        return a.tme[pos] < b.tme[pos];
-    }
-    
-    /* This class is used to sort EdgeDataType based on its "tme" value at position n. */
-    class EdgeSorter{
-        int pos;
+            /* Emit the last chunk (that might be < chunk_size). */
+            void finish() {
+                if (this->chunk_size > 0 && this->nlabels > 0)
+                    this->chunks->push_back(this->chunk_h);
+            }
 
-        public:
-            EdgeSorter(int pos) {
-                this->pos = pos;
+            unsigned long value() const {
+                return this->h;
             }
+#ifdef DEBUG
+            const std::string& string() const {
+                return this->str;
+            }
+#endif
+    };
+
+    /* The part of an in-coming edge that relabeling needs at one hop:
+     * the timestamp and label of the neighbor at that hop, and the
+     * edge label. WL sorts these compact keys instead of whole edges. */
+    struct NeighborKey {
+        unsigned long tme;
+        unsigned long label;
+        unsigned long edg;
+
+        NeighborKey() {}
+        NeighborKey(unsigned long tme, unsigned long label, unsigned long edg) {
+            this->tme = tme;
+            this->label = label;
+            this->edg = edg;
+        }
+    };
 
-            bool operator()(EdgeDataType a, EdgeDataType b) const {
-                return compareEdges(a, b, pos);
+    /* This class is used to sort NeighborKey based on its "tme" value. */
+    class NeighborKeySorter {
+        public:
+            bool operator()(const NeighborKey &a, const NeighborKey &b) const {
+                return a.tme < b.tme;
             }
     };
 
+    /* Temporary space for radix-sorting a neighborhood. Keep one
+     * per thread and reuse it, so that sorting large neighborhoods
+     * does not allocate. */
+    struct NeighborhoodScratch {
+        std::vector<NeighborKey> keys;
+        std::vector<bIndexT> digits;
+        intT counts[BUCKETS];
+    };
+
+    /* Sort the neighborhood by timestamp. Neighbors with the same
+     * timestamp are ordered as std::sort orders them, which is what
+     * WL has always done. If RADIX_THRESHOLD is set, neighborhoods of
+     * at least RADIX_THRESHOLD neighbors are radix-sorted instead
+     * (in @scratch); radix sort is stable, so ties may be ordered
+     * differently. */
+    void sort_neighborhood(std::vector<NeighborKey> &neighborhood, NeighborhoodScratch &scratch) {
+        if (RADIX_THRESHOLD > 0 && neighborhood.size() >= (size_t)RADIX_THRESHOLD) {
+            /* Sort on the offset from the smallest timestamp to sort fewer bits. */
+            unsigned long min_tme = neighborhood[0].tme;
+            unsigned long max_tme = neighborhood[0].tme;
+            for (size_t i = 1; i < neighborhood.size(); i++) {
+                min_tme = std::min(min_tme, neighborhood[i].tme);
+                max_tme = std::max(max_tme, neighborhood[i].tme);
+            }
+            /* radixSort works on signed 64-bit keys. */
+            if (max_tme - min_tme < (1UL << 62)) {
+                size_t n = neighborhood.size();
+                if (scratch.keys.size() < n) {
+                    scratch.keys.resize(n);
+                    scratch.digits.resize(n);
+                }
+                iSort(&neighborhood[0], (intT)n, (intT)(max_tme - min_tme),
+                      [min_tme](NeighborKey k) { return (intT)(k.tme - min_tme); },
+                      &scratch.keys[0], &scratch.digits[0], scratch.counts);
+                return;
+            }
+        }
+        std::sort(neighborhood.begin(), neighborhood.end(), NeighborKeySorter());
+    }
+
 }
 
 #endif /* __HELPER_HPP__ */
@@ -13,25 +13,53 @@
 #ifndef __HISTOGRAM_HPP__
 #define __HISTOGRAM_HPP__
 
+#include <atomic>
 #include <iostream>
-#include <map>
 #include <vector>
 #include <thread>
 #include <mutex>
 #include <math.h>
+#include <pthread.h>
 /* GraphChi header file. */
 #include "logger/logger.hpp"
 /* Unicorn header file. */
 #include "def.hpp"
+#include "counter_rng.hpp"
+#include "flat_table.hpp"
+#ifdef MEMORY
+#include "sketch_params.hpp"
+#endif
+
+/* In LAZY_DECAY mode, once the global scale factor
+ * drops below this value, we fold it back into the
+ * histogram and hash values to avoid underflow. */
+#define LAZY_DECAY_RENORM 1e-64
+
+/* One partition of the histogram. A label always
+ * lives in the shard picked by its hash. */
+struct HistogramShard {
+    FlatTable<double> table; /* table maps a label to its value. */
+    std::mutex lock;
+};
 
 /* We use singleton design to create a single instance of a histogram.
- * This is not thread-safe. A proper locking mechanism is needed.
- * Current implementation uses an ordered Map as the histogram. */
+ * Current implementation uses open-addressing hash tables (FlatTable)
+ * as the histogram. They are unordered; we sort labels only when we
+ * write the histogram out.
+ * To let concurrent WL updates proceed in parallel, the histogram is
+ * partitioned by label hash into HIST_SHARDS independently locked
+ * shards, and the sketch slots are partitioned into as many stripes,
+ * each with its own lock. An update locks one shard to count its label
+ * and then each stripe in turn to min-merge its hash values. Decay and
+ * sketch recording need a consistent view of everything, so they take
+ * scale_lock exclusively while updates take it shared.
+ * SK is the size of the sketch; there is one singleton per size. */
+template <int SK>
 class Histogram {
 public:
     static Histogram* get_instance();
     ~Histogram();
-    struct hist_elem construct_hist_elem(unsigned long label);
+    struct hist_elem<SK> construct_hist_elem(unsigned long label);
     void decay(FILE* fp);
     void update(unsigned long label, bool base);
     void create_sketch();
@@ -45,6 +73,13 @@ public:
 #endif
 
 private:
+    void renormalize();
+    HistogramShard* shard_for(unsigned long label);
+    std::vector<std::pair<unsigned long, double> > sorted_histogram();
+#ifdef MEMORY
+    void param_index(unsigned long label, int &pos1, int &pos2);
+#endif
+
     static Histogram* histogram;
 
     Histogram() {
@@ -56,33 +91,52 @@ private:
 	this->c = 0;
 #endif
         this->powerful = pow(M_E, -LAMBDA);
+        this->scale = 1;
+
+        this->nshards = HIST_SHARDS > 0 ? HIST_SHARDS : 1;
+        for (int i = 0; i < this->nshards; i++)
+            this->shards.push_back(new HistogramShard());
+        this->nstripes = this->nshards < SK ? this->nshards : SK;
+        this->stripe_locks = new std::mutex[this->nstripes];
+
+        /* Prefer the writer so that decay is not starved by updates. */
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+        pthread_rwlock_init(&this->scale_lock, &attr);
+        pthread_rwlockattr_destroy(&attr);
     }
 
-    std::map<unsigned long, double> histogram_map; /* histogram_map maps a label to its value. */
-    unsigned long sketch[SKETCH_SIZE];
-    double hash[SKETCH_SIZE];
+    std::vector<HistogramShard*> shards;
+    int nshards;
+    unsigned long sketch[SK];
+    double hash[SK];
     double powerful;
-#ifdef MEMORY   
-    /* PREGEN is a compilation constant defined using -D flag.
-     * It is the number of random variables we sampled ahead of time. */
-    double gamma_param[PREGEN][SKETCH_SIZE];
-    double r_beta_param[PREGEN][SKETCH_SIZE];
-    double power_r[PREGEN][SKETCH_SIZE];
+    double scale; /* Global scale factor: a value in the histogram (or in hash)
+                   * is its stored value times scale. It is always 1 unless
+                   * LAZY_DECAY is set. */
+#ifdef MEMORY
+    SketchParams<SK> params; /* Pre-sampled random variables (see sketch_params.hpp). */
 #endif
 
-    int t; /* If t reaches DECAY, we decay the values in the histogram and hashed value by e^(-lambda). */
+    std::atomic<unsigned long> t; /* Every DECAY updates, we decay the values in the histogram and hashed value by e^(-lambda). */
 #ifdef USEWINDOW
-    int w; /* If WINDOW is used, when we reach WINDOW, we record the sketch.
-	    * We may also use BATCH as the frequency to record the sketches.
-	    * In that case, w is not used. */
+    std::atomic<unsigned long> w; /* If WINDOW is used, every WINDOW updates, we record the sketch.
+				   * We may also use BATCH as the frequency to record the sketches.
+				   * In that case, w is not used. */
 #endif
 #ifdef VIZ
     int c; /* Count of histogram files to write. We write one histogram per
             * file, this counter is appended to the HIST_FILE file path. */
 #endif
-    
-    /* The lock needed to update histogram map. */
-    std::mutex histogram_map_lock;
+
+    /* Stripe k covers sketch slots [k * SK / nstripes,
+     * (k + 1) * SK / nstripes). */
+    int nstripes;
+    std::mutex* stripe_locks;
+    /* Taken shared by updates and exclusively by whoever
+     * changes the scale or reads everything at once. */
+    pthread_rwlock_t scale_lock;
 };
 
 #include "histogram.cpp"
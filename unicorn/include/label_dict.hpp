@@ -0,0 +1,180 @@
+/*
+ *
+ * Author: Xueyuan Han <hanx@g.harvard.edu>
+ *
+ * Copyright (C) 2018-2020 Harvard University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ */
+#ifndef __LABEL_DICT_HPP__
+#define __LABEL_DICT_HPP__
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+/* GraphChi header file. */
+#include "logger/logger.hpp"
+/* Unicorn header file. */
+#include "flat_table.hpp"
+
+/* Number of independently locked partitions of the label to ID map. */
+#define LABEL_DICT_SHARDS 64
+/* IDs are stored in chunks of 2^LABEL_DICT_CHUNK_BITS labels. */
+#define LABEL_DICT_CHUNK_BITS 16
+#define LABEL_DICT_CHUNK_SIZE (1UL << LABEL_DICT_CHUNK_BITS)
+#define LABEL_DICT_CHUNKS (1UL << (32 - LABEL_DICT_CHUNK_BITS))
+#define LABEL_DICT_MAGIC 0x3254434944424c55UL /* "ULBDICT2" */
+
+/* In COMPACT_EDGES mode, edges store 32-bit IDs instead of
+ * the 64-bit node and edge labels read from the graph. WL
+ * relabels are not interned: they are new in every hop of
+ * every batch, so the dictionary would grow without bound.
+ * We use singleton design to create a single dictionary
+ * that interns labels (label -> ID) and decodes IDs
+ * (ID -> label) for all threads.
+ * - Interning locks one of LABEL_DICT_SHARDS shards of the
+ *   label to ID map, picked by the label.
+ * - Decoding takes no lock: the ID to label array is made
+ *   of fixed-size chunks that are never moved once they are
+ *   allocated. An ID is published (through the graph) only
+ *   after its label is written.
+ * The dictionary must be saved alongside the shards, since
+ * the shards cannot be decoded without it. */
+class LabelDictionary {
+public:
+    static LabelDictionary* get_instance() {
+        static LabelDictionary dictionary;
+        return &dictionary;
+    }
+
+    /* Returns the ID of @label, assigning the next ID if @label is new. */
+    uint32_t intern(unsigned long label) {
+        LabelDictionaryShard* shard = this->shard_for(label);
+        std::lock_guard<std::mutex> guard(shard->lock);
+        uint32_t* id = shard->table.find(label);
+        if (id != NULL)
+            return *id;
+        uint64_t next = this->count.fetch_add(1);
+        if (next >= LABEL_DICT_CHUNKS * LABEL_DICT_CHUNK_SIZE) {
+            logstream(LOG_ERROR) << "Too many distinct labels for 32-bit label IDs." << std::endl;
+            assert(false);
+        }
+        unsigned long* chunk = this->chunk_for(next);
+        chunk[next & (LABEL_DICT_CHUNK_SIZE - 1)] = label;
+        shard->table.insert(label, (uint32_t)next);
+        return (uint32_t)next;
+    }
+
+    /* Returns the label of @id. */
+    inline unsigned long label(uint32_t id) const {
+        return this->chunks[id >> LABEL_DICT_CHUNK_BITS].load(std::memory_order_acquire)[id & (LABEL_DICT_CHUNK_SIZE - 1)];
+    }
+
+    size_t size() const {
+        return this->count.load();
+    }
+
+    /* Write the dictionary to @path: a header (magic,
+     * number of labels) followed by the labels in ID
+     * order. Returns false on error. */
+    bool save(std::string path) {
+        FILE* fp = fopen(path.c_str(), "wb");
+        if (fp == NULL) {
+            logstream(LOG_ERROR) << "Unable to open the label dictionary to write: " << path << ". Error code: " << strerror(errno) << std::endl;
+            return false;
+        }
+        uint64_t header[2];
+        header[0] = LABEL_DICT_MAGIC;
+        header[1] = this->count.load();
+        bool ok = fwrite(header, sizeof(header), 1, fp) == 1;
+        for (uint64_t c = 0; ok && c * LABEL_DICT_CHUNK_SIZE < header[1]; c++) {
+            uint64_t n = header[1] - c * LABEL_DICT_CHUNK_SIZE;
+            if (n > LABEL_DICT_CHUNK_SIZE)
+                n = LABEL_DICT_CHUNK_SIZE;
+            ok = fwrite(this->chunks[c].load(), sizeof(unsigned long), n, fp) == n;
+        }
+        if (fclose(fp) != 0 || !ok) {
+            logstream(LOG_ERROR) << "Unable to write the label dictionary: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /* Read the dictionary saved at @path into this (empty)
+     * dictionary. Returns false if @path does not exist. */
+    bool load(std::string path) {
+        FILE* fp = fopen(path.c_str(), "rb");
+        if (fp == NULL)
+            return false;
+        assert(this->count.load() == 0);
+        uint64_t header[2];
+        if (fread(header, sizeof(header), 1, fp) != 1 || header[0] != LABEL_DICT_MAGIC) {
+            logstream(LOG_ERROR) << "Not a label dictionary: " << path << std::endl;
+            assert(false);
+        }
+        for (uint64_t i = 0; i < header[1]; i++) {
+            unsigned long label;
+            if (fread(&label, sizeof(label), 1, fp) != 1) {
+                logstream(LOG_ERROR) << "Label dictionary is truncated: " << path << std::endl;
+                assert(false);
+            }
+            uint32_t id = this->intern(label);
+            assert(id == i);
+        }
+        fclose(fp);
+        return true;
+    }
+
+private:
+    struct LabelDictionaryShard {
+        FlatTable<uint32_t> table; /* table maps a label to its ID. */
+        std::mutex lock;
+    };
+
+    LabelDictionary() : count(0) {
+        for (size_t i = 0; i < LABEL_DICT_CHUNKS; i++)
+            this->chunks[i].store(NULL);
+    }
+
+    ~LabelDictionary() {
+        for (size_t i = 0; i < LABEL_DICT_CHUNKS; i++)
+            delete[] this->chunks[i].load();
+    }
+
+    /* FlatTable uses the high bits of a Fibonacci hash, so we
+     * pick the shard with an unrelated mix (as Histogram does). */
+    LabelDictionaryShard* shard_for(unsigned long label) {
+        unsigned long h = label ^ (label >> 31);
+        h *= 0xBF58476D1CE4E5B9UL;
+        h ^= h >> 29;
+        return &this->shards[h & (LABEL_DICT_SHARDS - 1)];
+    }
+
+    /* Returns the chunk that holds @id, allocating it if needed. */
+    unsigned long* chunk_for(uint64_t id) {
+        std::atomic<unsigned long*>& slot = this->chunks[id >> LABEL_DICT_CHUNK_BITS];
+        unsigned long* chunk = slot.load(std::memory_order_acquire);
+        if (chunk != NULL)
+            return chunk;
+        unsigned long* fresh = new unsigned long[LABEL_DICT_CHUNK_SIZE];
+        if (slot.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel))
+            return fresh;
+        delete[] fresh; /* Another thread allocated it first. */
+        return chunk;
+    }
+
+    LabelDictionaryShard shards[LABEL_DICT_SHARDS];
+    std::atomic<uint64_t> count; /* Number of IDs handed out. */
+    std::atomic<unsigned long*> chunks[LABEL_DICT_CHUNKS];
+};
+
+#endif /* __LABEL_DICT_HPP__ */
@@ -0,0 +1,197 @@
+/*
+ *
+ * Author: Xueyuan Han <hanx@g.harvard.edu>
+ *
+ * Copyright (C) 2018-2020 Harvard University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ */
+#ifndef __SKETCH_KERNEL_HPP__
+#define __SKETCH_KERNEL_HPP__
+
+/* The per-label sketch update loop used in MEMORY mode.
+ * For every sketch slot i in [lo, hi), it computes
+ *     a = c[i] / ((value / r_beta[i]) * power_r[i]) / scale
+ * and, if a < hash[i], sets hash[i] = a and sketch[i] = label.
+ * We have a scalar version and AVX2/AVX-512 versions; the best
+ * one the CPU supports is picked at run time. All versions do
+ * the same operations in the same order (no reciprocals), so
+ * they produce the same hash values and thus the same sketch.
+ * The compact kernels do the same for COMPACT_PARAMS, where
+ *     a = c[i] * q[i] / value / scale
+ * with c and q stored as floats (see sketch_params.hpp). */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SKETCH_KERNEL_X86
+#endif
+
+typedef void (*sketch_kernel_t)(const double* c, const double* r_beta, const double* power_r,
+                                double value, double scale, unsigned long label,
+                                double* hash, unsigned long* sketch, int lo, int hi);
+
+static void sketch_kernel_scalar(const double* c, const double* r_beta, const double* power_r,
+                                 double value, double scale, unsigned long label,
+                                 double* hash, unsigned long* sketch, int lo, int hi) {
+    for (int i = lo; i < hi; i++) {
+        double y = value / r_beta[i];
+        double a = c[i] / (y * power_r[i]) / scale;
+        if (a < hash[i]) {
+            hash[i] = a;
+            sketch[i] = label;
+        }
+    }
+}
+
+#ifdef SKETCH_KERNEL_X86
+__attribute__((target("avx2")))
+static void sketch_kernel_avx2(const double* c, const double* r_beta, const double* power_r,
+                               double value, double scale, unsigned long label,
+                               double* hash, unsigned long* sketch, int lo, int hi) {
+    const __m256d v = _mm256_set1_pd(value);
+    const __m256d s = _mm256_set1_pd(scale);
+    const __m256d l = _mm256_castsi256_pd(_mm256_set1_epi64x((long long)label));
+    int i = lo;
+    for (; i + 4 <= hi; i += 4) {
+        __m256d y = _mm256_div_pd(v, _mm256_loadu_pd(r_beta + i));
+        __m256d a = _mm256_div_pd(_mm256_div_pd(_mm256_loadu_pd(c + i),
+                                                _mm256_mul_pd(y, _mm256_loadu_pd(power_r + i))), s);
+        __m256d h = _mm256_loadu_pd(hash + i);
+        __m256d lt = _mm256_cmp_pd(a, h, _CMP_LT_OQ);
+        /* Most of the time no slot changes. */
+        if (_mm256_movemask_pd(lt) == 0)
+            continue;
+        _mm256_storeu_pd(hash + i, _mm256_blendv_pd(h, a, lt));
+        __m256d k = _mm256_loadu_pd((const double*)(sketch + i));
+        _mm256_storeu_pd((double*)(sketch + i), _mm256_blendv_pd(k, l, lt));
+    }
+    sketch_kernel_scalar(c, r_beta, power_r, value, scale, label, hash, sketch, i, hi);
+}
+
+__attribute__((target("avx512f")))
+static void sketch_kernel_avx512(const double* c, const double* r_beta, const double* power_r,
+                                 double value, double scale, unsigned long label,
+                                 double* hash, unsigned long* sketch, int lo, int hi) {
+    const __m512d v = _mm512_set1_pd(value);
+    const __m512d s = _mm512_set1_pd(scale);
+    const __m512i l = _mm512_set1_epi64((long long)label);
+    for (int i = lo; i < hi; i += 8) {
+        /* The tail is handled with a partial mask. Masked-out
+         * lanes load 1.0 so they do not divide by zero. */
+        __mmask8 m = hi - i >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << (hi - i)) - 1);
+        const __m512d one = _mm512_set1_pd(1.0);
+        __m512d y = _mm512_div_pd(v, _mm512_mask_loadu_pd(one, m, r_beta + i));
+        __m512d a = _mm512_div_pd(_mm512_div_pd(_mm512_mask_loadu_pd(one, m, c + i),
+                                                _mm512_mul_pd(y, _mm512_mask_loadu_pd(one, m, power_r + i))), s);
+        __mmask8 lt = _mm512_mask_cmp_pd_mask(m, a, _mm512_mask_loadu_pd(one, m, hash + i), _CMP_LT_OQ);
+        if (lt == 0)
+            continue;
+        _mm512_mask_storeu_pd(hash + i, lt, a);
+        _mm512_mask_storeu_epi64(sketch + i, lt, l);
+    }
+}
+#endif
+
+typedef void (*compact_sketch_kernel_t)(const float* c, const float* q,
+                                        double value, double scale, unsigned long label,
+                                        double* hash, unsigned long* sketch, int lo, int hi);
+
+static void compact_sketch_kernel_scalar(const float* c, const float* q,
+                                         double value, double scale, unsigned long label,
+                                         double* hash, unsigned long* sketch, int lo, int hi) {
+    for (int i = lo; i < hi; i++) {
+        double a = (double)c[i] * (double)q[i] / value / scale;
+        if (a < hash[i]) {
+            hash[i] = a;
+            sketch[i] = label;
+        }
+    }
+}
+
+#ifdef SKETCH_KERNEL_X86
+__attribute__((target("avx2")))
+static void compact_sketch_kernel_avx2(const float* c, const float* q,
+                                       double value, double scale, unsigned long label,
+                                       double* hash, unsigned long* sketch, int lo, int hi) {
+    const __m256d v = _mm256_set1_pd(value);
+    const __m256d s = _mm256_set1_pd(scale);
+    const __m256d l = _mm256_castsi256_pd(_mm256_set1_epi64x((long long)label));
+    int i = lo;
+    for (; i + 4 <= hi; i += 4) {
+        __m256d cq = _mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(c + i)), _mm256_cvtps_pd(_mm_loadu_ps(q + i)));
+        __m256d a = _mm256_div_pd(_mm256_div_pd(cq, v), s);
+        __m256d h = _mm256_loadu_pd(hash + i);
+        __m256d lt = _mm256_cmp_pd(a, h, _CMP_LT_OQ);
+        if (_mm256_movemask_pd(lt) == 0)
+            continue;
+        _mm256_storeu_pd(hash + i, _mm256_blendv_pd(h, a, lt));
+        __m256d k = _mm256_loadu_pd((const double*)(sketch + i));
+        _mm256_storeu_pd((double*)(sketch + i), _mm256_blendv_pd(k, l, lt));
+    }
+    compact_sketch_kernel_scalar(c, q, value, scale, label, hash, sketch, i, hi);
+}
+
+__attribute__((target("avx512f,avx512vl")))
+static void compact_sketch_kernel_avx512(const float* c, const float* q,
+                                         double value, double scale, unsigned long label,
+                                         double* hash, unsigned long* sketch, int lo, int hi) {
+    const __m512d v = _mm512_set1_pd(value);
+    const __m512d s = _mm512_set1_pd(scale);
+    const __m512i l = _mm512_set1_epi64((long long)label);
+    for (int i = lo; i < hi; i += 8) {
+        /* The tail is handled with a partial mask. Masked-out
+         * lanes load 0 (and 0 / value is harmless). */
+        __mmask8 m = hi - i >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << (hi - i)) - 1);
+        /* The floats are loaded at 256 bits (AVX-512VL) and widened
+         * with the zero-masking convert; the plain convert starts from
+         * an undefined vector, which GCC reports as maybe-uninitialized. */
+        __m512d cq = _mm512_mul_pd(_mm512_maskz_cvtps_pd(m, _mm256_maskz_loadu_ps(m, c + i)),
+                                   _mm512_maskz_cvtps_pd(m, _mm256_maskz_loadu_ps(m, q + i)));
+        __m512d a = _mm512_div_pd(_mm512_div_pd(cq, v), s);
+        __mmask8 lt = _mm512_mask_cmp_pd_mask(m, a, _mm512_maskz_loadu_pd(m, hash + i), _CMP_LT_OQ);
+        if (lt == 0)
+            continue;
+        _mm512_mask_storeu_pd(hash + i, lt, a);
+        _mm512_mask_storeu_epi64(sketch + i, lt, l);
+    }
+}
+#endif
+
+/* Pick the kernel once, based on what the CPU supports. */
+static sketch_kernel_t select_sketch_kernel() {
+#ifdef SKETCH_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return sketch_kernel_avx512;
+    if (__builtin_cpu_supports("avx2"))
+        return sketch_kernel_avx2;
+#endif
+    return sketch_kernel_scalar;
+}
+
+static inline sketch_kernel_t sketch_kernel() {
+    static const sketch_kernel_t kernel = select_sketch_kernel();
+    return kernel;
+}
+
+static compact_sketch_kernel_t select_compact_sketch_kernel() {
+#ifdef SKETCH_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl"))
+        return compact_sketch_kernel_avx512;
+    if (__builtin_cpu_supports("avx2"))
+        return compact_sketch_kernel_avx2;
+#endif
+    return compact_sketch_kernel_scalar;
+}
+
+static inline compact_sketch_kernel_t compact_sketch_kernel() {
+    static const compact_sketch_kernel_t kernel = select_compact_sketch_kernel();
+    return kernel;
+}
+
+#endif /* __SKETCH_KERNEL_HPP__ */
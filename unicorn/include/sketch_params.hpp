@@ -0,0 +1,153 @@
+/*
+ *
+ * Author: Xueyuan Han <hanx@g.harvard.edu>
+ *
+ * Copyright (C) 2018-2020 Harvard University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ */
+#ifndef __SKETCH_PARAMS_HPP__
+#define __SKETCH_PARAMS_HPP__
+
+#include <cstdlib>
+#include <math.h>
+#include <random>
+#include <vector>
+/* Unicorn header files. */
+#include "def.hpp"
+#include "sketch_kernel.hpp"
+
+/* Pre-sampled sketch parameters used in MEMORY mode.
+ * PREGEN rows are sampled ahead of time; each row holds,
+ * for every sketch slot, r ~ Gamma(2, 1) and beta ~ Uniform(0, 1)
+ * (and r of another row serves as c ~ Gamma(2, 1)). A label
+ * picks row pos1 for r and beta and row pos2 for c, and its
+ * hash value in slot i for histogram value v is
+ *     a = c / ((v / e^(r * beta)) * e^r) = c * e^(-r * (1 - beta)) / v.
+ * Two stores are available:
+ * - FullSketchParams keeps r, e^(r * beta) and e^r as doubles
+ *   (24 bytes per row and slot). This is the original layout.
+ * - CompactSketchParams (-DCOMPACT_PARAMS) keeps c and the
+ *   derived q = e^(-r * (1 - beta)) as floats (8 bytes per row
+ *   and slot), so a = c * q / v. Hash values then match the
+ *   full store up to single-precision rounding (see
+ *   param_check.cpp), so sketches may differ in rare near-ties. */
+
+/* Sample r and beta of one row from @seed. The first
+ * rows of both stores are thus exactly the same. */
+static void sample_param_row(int seed, double* r, double* beta, int sketch_size) {
+    std::gamma_distribution<double> gamma_dist(2.0, 1.0);
+    std::uniform_real_distribution<double> uniform_dist(0.0, 1.0);
+    std::default_random_engine r_generator(seed);
+    std::default_random_engine beta_generator(seed);
+    for (int j = 0; j < sketch_size; j++) {
+        r[j] = gamma_dist(r_generator);
+        beta[j] = uniform_dist(beta_generator);
+    }
+}
+
+/* Row seeds must be drawn in order from srand(36),
+ * but then each row only depends on its own seed. */
+static std::vector<int> param_row_seeds() {
+    std::vector<int> seeds(PREGEN);
+    srand(36); /* Set a seed. */
+    for (int i = 0; i < PREGEN; i++)
+        seeds[i] = rand();
+    return seeds;
+}
+
+template <int SK>
+class FullSketchParams {
+public:
+    /* Pre-sample random variables. Rows are sampled in parallel. */
+    void generate() {
+        std::vector<int> seeds = param_row_seeds();
+#pragma omp parallel for schedule(dynamic, 16)
+        for (int i = 0; i < PREGEN; i++) {
+            double beta[SK];
+            sample_param_row(seeds[i], this->gamma_param[i], beta, SK);
+            for (int j = 0; j < SK; j++) {
+                this->r_beta_param[i][j] = pow(M_E, this->gamma_param[i][j] * beta[j]);
+                this->power_r[i][j] = pow(M_E, this->gamma_param[i][j]);
+            }
+        }
+    }
+
+    /* The hash value of slot @i (before the lazy decay scale). */
+    inline double hash_value(int pos1, int pos2, int i, double value) const {
+        double y = value / this->r_beta_param[pos1][i];
+        return this->gamma_param[pos2][i] / (y * this->power_r[pos1][i]);
+    }
+
+    /* Min-merge the hash values of slots [lo, hi) into @hash and @sketch. */
+    inline void update_sketch(int pos1, int pos2, double value, double scale, unsigned long label,
+                              double* hash, unsigned long* sketch, int lo, int hi) const {
+        sketch_kernel()(this->gamma_param[pos2], this->r_beta_param[pos1], this->power_r[pos1],
+                        value, scale, label, hash, sketch, lo, hi);
+    }
+
+    static size_t bytes() {
+        return sizeof(FullSketchParams);
+    }
+
+private:
+    /* PREGEN is a compilation constant defined using -D flag.
+     * It is the number of random variables we sampled ahead of time. */
+    double gamma_param[PREGEN][SK];
+    double r_beta_param[PREGEN][SK];
+    double power_r[PREGEN][SK];
+};
+
+template <int SK>
+class CompactSketchParams {
+public:
+    /* Pre-sample random variables. Rows are sampled in parallel.
+     * We derive q in double precision and only then round it. */
+    void generate() {
+        std::vector<int> seeds = param_row_seeds();
+#pragma omp parallel for schedule(dynamic, 16)
+        for (int i = 0; i < PREGEN; i++) {
+            double r[SK];
+            double beta[SK];
+            sample_param_row(seeds[i], r, beta, SK);
+            for (int j = 0; j < SK; j++) {
+                this->gamma_param[i][j] = (float)r[j];
+                this->q_param[i][j] = (float)pow(M_E, -r[j] * (1 - beta[j]));
+            }
+        }
+    }
+
+    /* The hash value of slot @i (before the lazy decay scale). */
+    inline double hash_value(int pos1, int pos2, int i, double value) const {
+        return (double)this->gamma_param[pos2][i] * (double)this->q_param[pos1][i] / value;
+    }
+
+    /* Min-merge the hash values of slots [lo, hi) into @hash and @sketch. */
+    inline void update_sketch(int pos1, int pos2, double value, double scale, unsigned long label,
+                              double* hash, unsigned long* sketch, int lo, int hi) const {
+        compact_sketch_kernel()(this->gamma_param[pos2], this->q_param[pos1],
+                                value, scale, label, hash, sketch, lo, hi);
+    }
+
+    static size_t bytes() {
+        return sizeof(CompactSketchParams);
+    }
+
+private:
+    float gamma_param[PREGEN][SK];
+    float q_param[PREGEN][SK];
+};
+
+#ifdef COMPACT_PARAMS
+template <int SK>
+using SketchParams = CompactSketchParams<SK>;
+#else
+template <int SK>
+using SketchParams = FullSketchParams<SK>;
+#endif
+
+#endif /* __SKETCH_PARAMS_HPP__ */
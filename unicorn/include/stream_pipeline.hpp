@@ -0,0 +1,235 @@
+/*
+ *
+ * Author: Xueyuan Han <hanx@g.harvard.edu>
+ *
+ * Copyright (C) 2018-2020 Harvard University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ */
+#ifndef __STREAM_PIPELINE_HPP__
+#define __STREAM_PIPELINE_HPP__
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+/* GraphChi header files. */
+#include "graphchi_types.hpp"
+#include "engine/dynamic_graphs/edgebuffers.hpp"
+/* Unicorn header files. */
+#include "binary_format.hpp"
+#include "def.hpp"
+#include "helper.hpp"
+#include "stream_reader.hpp"
+
+/* Size of the chunks of the stream file that parser threads take. */
+#ifndef STREAM_CHUNK_SIZE
+#define STREAM_CHUNK_SIZE (1 << 20)
+#endif
+
+/* What StreamPipeline::poll_edge() returns. */
+#define STREAM_EDGE 0    /* Here is the next edge. */
+#define STREAM_TIMEOUT 1 /* No edge arrived before the deadline. */
+#define STREAM_END 2     /* All edges have been returned. */
+
+/* Parses the stream graph file in parallel, ahead of the
+ * thread that adds the edges to the graph. The file is cut
+ * into chunks of whole lines, numbered in file order. Each of
+ * @nthreads parser threads takes the next chunk, parses it
+ * into a batch of created_edge and publishes the batch in the
+ * slot of its number. The consumer takes batches strictly in
+ * number order, so edges reach the graph in file order no
+ * matter which thread parsed them. At most @window batches
+ * exist at a time: parser threads wait until the consumer
+ * releases one, which bounds memory use. Parser threads keep
+ * working while the consumer waits for GraphChi WL.
+ * A binary stream file (see binary_format.hpp) is cut into
+ * chunks of whole records instead, which need no parsing.
+ * From a live source, a chunk is whatever has arrived, and
+ * the consumer can wait for an edge until a deadline. */
+template <int KH>
+class StreamPipeline {
+public:
+    typedef graphchi::created_edge<edge_label<KH> > edge_t;
+    typedef std::chrono::steady_clock clock;
+
+    StreamPipeline(StreamReader* reader, int nthreads, int window) {
+        this->reader = reader;
+        this->nchunks = 0;
+        this->released = 0;
+        this->holding = false;
+        this->done = false;
+        this->cur = NULL;
+        this->cur_end = NULL;
+        this->record_size = read_binary_header(reader, BINARY_KIND_STREAM) ? sizeof(binary_record) : 0;
+        this->nslots = window > 1 ? window : 2;
+        this->slots.resize(this->nslots);
+        for (int i = 0; i < this->nslots; i++)
+            this->slots[i].seq = (unsigned long)-1;
+        if (nthreads < 1)
+            nthreads = 1;
+        for (int i = 0; i < nthreads; i++)
+            this->threads.push_back(std::thread(&StreamPipeline::parse_loop, this));
+    }
+
+    ~StreamPipeline() {
+        this->join();
+    }
+
+    /* Set @edge to the next edge in file order. Returns
+     * false once all edges have been returned. The edge
+     * is valid until the end of its batch. */
+    bool next_edge(const edge_t** edge) {
+        return this->poll_edge(edge, NULL) == STREAM_EDGE;
+    }
+
+    /* As next_edge(), but if @deadline is not NULL, give up
+     * waiting for the next edge at @deadline. Returns
+     * STREAM_EDGE, STREAM_TIMEOUT or STREAM_END. */
+    int poll_edge(const edge_t** edge, const clock::time_point* deadline) {
+        while (this->cur == this->cur_end) {
+            size_t n;
+            int ret = this->next_batch(&this->cur, &n, deadline);
+            if (ret != STREAM_EDGE) {
+                this->cur = this->cur_end = NULL;
+                return ret;
+            }
+            this->cur_end = this->cur + n;
+        }
+        *edge = this->cur++;
+        return STREAM_EDGE;
+    }
+
+    /* Release the batch we returned last time and set @edges
+     * and @n to the next batch in file order. Returns false
+     * once all batches have been returned. */
+    bool next_batch(const edge_t** edges, size_t* n) {
+        return this->next_batch(edges, n, NULL) == STREAM_EDGE;
+    }
+
+    /* As next_batch(), but if @deadline is not NULL, give up
+     * waiting at @deadline. Returns STREAM_EDGE (there is a
+     * batch), STREAM_TIMEOUT or STREAM_END. */
+    int next_batch(const edge_t** edges, size_t* n, const clock::time_point* deadline) {
+        std::unique_lock<std::mutex> guard(this->lock);
+        if (this->holding) {
+            this->slots[this->released % this->nslots].seq = (unsigned long)-1;
+            this->released++;
+            this->holding = false;
+            this->space.notify_all();
+        }
+        Slot* slot = &this->slots[this->released % this->nslots];
+        while (slot->seq != this->released && !(this->done && this->released >= this->nchunks)) {
+            if (deadline == NULL)
+                this->ready.wait(guard);
+            else if (this->ready.wait_until(guard, *deadline) == std::cv_status::timeout)
+                return STREAM_TIMEOUT;
+        }
+        if (slot->seq != this->released) {
+            guard.unlock();
+            this->join();
+            return STREAM_END;
+        }
+        this->holding = true;
+        *edges = slot->edges.data();
+        *n = slot->edges.size();
+        return STREAM_EDGE;
+    }
+
+private:
+    struct Slot {
+        unsigned long seq; /* Number of the batch in the slot, or -1 if it is free. */
+        std::vector<char> copy; /* The chunk, if the reader cannot keep it for us. */
+        std::vector<edge_t> edges;
+    };
+
+    void parse_loop() {
+        while (true) {
+            unsigned long seq;
+            const char* chunk;
+            size_t len;
+            Slot* slot;
+            {
+                /* Chunks are cut one at a time, in file order. */
+                std::lock_guard<std::mutex> read_guard(this->read_lock);
+                {
+                    std::unique_lock<std::mutex> guard(this->lock);
+                    if (this->done)
+                        return;
+                    seq = this->nchunks;
+                    while (seq >= this->released + this->nslots)
+                        this->space.wait(guard);
+                }
+                bool found;
+                if (this->record_size > 0)
+                    found = this->reader->next_records(&chunk, &len, STREAM_CHUNK_SIZE, this->record_size);
+                else
+                    found = this->reader->next_chunk(&chunk, &len, STREAM_CHUNK_SIZE);
+                if (!found) {
+                    std::lock_guard<std::mutex> guard(this->lock);
+                    this->done = true;
+                    this->ready.notify_all();
+                    return;
+                }
+                slot = &this->slots[seq % this->nslots];
+                if (!this->reader->is_mapped()) {
+                    slot->copy.assign(chunk, chunk + len);
+                    chunk = slot->copy.data();
+                }
+                std::lock_guard<std::mutex> guard(this->lock);
+                this->nchunks++;
+            }
+
+            slot->edges.clear();
+            const char* end = chunk + len;
+            while (this->record_size > 0 && chunk < end) {
+                graphchi::vid_t src, dst;
+                edge_label<KH> e = edge_label<KH>();
+                binary_record_to_edge(chunk, src, dst, e);
+                slot->edges.push_back(edge_t(src, dst, e));
+                chunk += this->record_size;
+            }
+            while (chunk < end) {
+                const char* nl = find_newline(chunk, end);
+                graphchi::vid_t src, dst;
+                edge_label<KH> e = edge_label<KH>();
+                graphchi::parse_stream_edge(chunk, nl - chunk, src, dst, e);
+                slot->edges.push_back(edge_t(src, dst, e));
+                chunk = nl + 1;
+            }
+
+            std::lock_guard<std::mutex> guard(this->lock);
+            slot->seq = seq;
+            this->ready.notify_all();
+        }
+    }
+
+    void join() {
+        for (size_t i = 0; i < this->threads.size(); i++)
+            if (this->threads[i].joinable())
+                this->threads[i].join();
+    }
+
+    StreamReader* reader;
+    std::vector<std::thread> threads;
+    std::vector<Slot> slots;
+    int nslots;
+    size_t record_size; /* Size of a record, or 0 if the file is text. */
+    std::mutex read_lock; /* Taken while cutting a chunk. */
+    std::mutex lock; /* Protects everything below and the seq of slots. */
+    std::condition_variable ready; /* A batch is parsed (or there are no more). */
+    std::condition_variable space; /* The consumer released a batch. */
+    unsigned long nchunks; /* Number of chunks cut so far. */
+    unsigned long released; /* Number of batches the consumer released. */
+    bool holding; /* Whether the consumer holds batch number released. */
+    bool done; /* Whether all chunks have been cut. */
+    const edge_t* cur; /* The rest of the batch next_edge walks. */
+    const edge_t* cur_end;
+};
+
+#endif /* __STREAM_PIPELINE_HPP__ */
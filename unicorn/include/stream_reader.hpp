@@ -0,0 +1,293 @@
+/*
+ *
+ * Author: Xueyuan Han <hanx@g.harvard.edu>
+ *
+ * Copyright (C) 2018-2020 Harvard University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ */
+#ifndef __STREAM_READER_HPP__
+#define __STREAM_READER_HPP__
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+/* GraphChi header file. */
+#include "logger/logger.hpp"
+
+/* Size of the blocks we read when the stream cannot be mapped. */
+#define STREAM_BLOCK_SIZE (1 << 20)
+
+/* Returns the first '\n' in [p, end), or end if there is none.
+ * With SSE2 we compare 16 bytes at a time. */
+static inline const char* find_newline(const char* p, const char* end) {
+#ifdef __SSE2__
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; p + 16 <= end; p += 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), nl));
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+#endif
+    for (; p < end; p++)
+        if (*p == '\n')
+            return p;
+    return end;
+}
+
+/* Reads the stream graph file line by line without copying:
+ * a regular file is mapped into memory as a whole; anything
+ * else is read in large blocks. Lines are not NUL-terminated
+ * and can be of any length.
+ * Besides files, we read from stdin (path "-"), a FIFO or a
+ * Unix domain socket (we connect to it). Those are live
+ * sources: data arrives as a producer writes it, so we hand
+ * out whatever whole lines have arrived instead of waiting
+ * for a full chunk (see next_chunk()). */
+class StreamReader {
+public:
+    StreamReader(std::string path) {
+        this->path = path;
+        this->data = NULL;
+        this->size = 0;
+        this->pos = 0;
+        this->mapped = false;
+        this->live = false;
+        this->eof = false;
+        this->failed = false;
+        this->fd = open_source(path);
+        if (this->fd < 0)
+            logstream(LOG_ERROR) << "Unable to open the file to read: " << path << ". Error code: " << strerror(errno) << std::endl;
+        assert(this->fd >= 0);
+        struct stat st;
+        bool regular = fstat(this->fd, &st) == 0 && S_ISREG(st.st_mode);
+        this->live = !regular;
+        if (regular) {
+            this->eof = true;
+            if (st.st_size == 0)
+                return;
+            void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, this->fd, 0);
+            if (addr != MAP_FAILED) {
+                madvise(addr, st.st_size, MADV_SEQUENTIAL);
+                this->data = (const char*)addr;
+                this->size = st.st_size;
+                this->mapped = true;
+                return;
+            }
+            this->eof = false;
+        }
+        /* Fall back to reading blocks. */
+        this->buffer.resize(STREAM_BLOCK_SIZE);
+        this->data = &this->buffer[0];
+    }
+
+    ~StreamReader() {
+        this->close();
+    }
+
+    /* Set @line and @len to the next line (without the '\n').
+     * Returns false once there are no more lines. */
+    bool next_line(const char** line, size_t* len) {
+        while (true) {
+            const char* begin = this->data + this->pos;
+            const char* end = this->data + this->size;
+            const char* nl = find_newline(begin, end);
+            if (nl != end) {
+                *line = begin;
+                *len = nl - begin;
+                this->pos = nl + 1 - this->data;
+                return true;
+            }
+            if (this->eof) {
+                /* The last line may not end with '\n'. */
+                if (begin == end)
+                    return false;
+                *line = begin;
+                *len = end - begin;
+                this->pos = this->size;
+                return true;
+            }
+            this->refill();
+        }
+    }
+
+    /* Set @chunk and @len to the next run of whole lines (including
+     * their '\n'), of about @target bytes (or one line if it is
+     * longer). Returns false once there are no more lines. Unless
+     * is_mapped(), the chunk is only valid until the next call. */
+    bool next_chunk(const char** chunk, size_t* len, size_t target) {
+        while (true) {
+            size_t rest = this->size - this->pos;
+            const char* begin = this->data + this->pos;
+            if (rest > target) {
+                const char* nl = find_newline(begin + target, this->data + this->size);
+                if (nl != this->data + this->size) {
+                    *chunk = begin;
+                    *len = nl + 1 - begin;
+                    this->pos += *len;
+                    return true;
+                }
+            }
+            if (this->live && !this->eof) {
+                /* Hand out the whole lines that have arrived. */
+                const char* nl = (const char*)memrchr(begin, '\n', rest);
+                if (nl != NULL) {
+                    *chunk = begin;
+                    *len = nl + 1 - begin;
+                    this->pos += *len;
+                    return true;
+                }
+            }
+            if (this->eof) {
+                if (rest == 0)
+                    return false;
+                /* The rest of the file (whose last line may not end with '\n'). */
+                *chunk = begin;
+                *len = rest;
+                this->pos = this->size;
+                return true;
+            }
+            this->refill();
+        }
+    }
+
+    /* Set @chunk and @len to the next run of whole @record_size
+     * byte records, of about @target bytes (at least one record;
+     * from a live source, the whole records that have arrived).
+     * Returns false once there are no more records. Unless
+     * is_mapped(), the chunk is only valid until the next call. */
+    bool next_records(const char** chunk, size_t* len, size_t target, size_t record_size) {
+        size_t want = target > record_size ? target - target % record_size : record_size;
+        while (this->size - this->pos < want && !this->eof
+               && !(this->live && this->size - this->pos >= record_size))
+            this->refill();
+        size_t rest = this->size - this->pos;
+        if (this->eof && rest % record_size != 0 && rest < want) {
+            logstream(LOG_ERROR) << "The stream file ends with a partial record: " << this->path << std::endl;
+            assert(false);
+        }
+        if (rest == 0)
+            return false;
+        *chunk = this->data + this->pos;
+        *len = rest < want ? rest - rest % record_size : want;
+        this->pos += *len;
+        return true;
+    }
+
+    /* Set @p to the next @n bytes without consuming them.
+     * Returns false if fewer than @n bytes are left. */
+    bool peek(const char** p, size_t n) {
+        while (this->size - this->pos < n && !this->eof)
+            this->refill();
+        if (this->size - this->pos < n)
+            return false;
+        *p = this->data + this->pos;
+        return true;
+    }
+
+    /* Consume @n bytes (that peek() returned). */
+    void skip(size_t n) {
+        this->pos += n;
+    }
+
+    bool is_mapped() const {
+        return this->mapped;
+    }
+
+    bool is_live() const {
+        return this->live;
+    }
+
+    /* Returns false if we could not read or close the file. */
+    bool close() {
+        bool ok = true;
+        if (this->mapped && munmap((void*)this->data, this->size) != 0)
+            ok = false;
+        this->mapped = false;
+        if (this->fd >= 0 && ::close(this->fd) != 0)
+            ok = false;
+        this->fd = -1;
+        return ok && !this->failed;
+    }
+
+private:
+    /* Open @path for reading: "-" is stdin, and we
+     * connect to a Unix domain socket. Returns -1 on error. */
+    static int open_source(std::string path) {
+        if (path == "-")
+            return dup(STDIN_FILENO);
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode))
+            return open(path.c_str(), O_RDONLY);
+        struct sockaddr_un addr;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, path.c_str(), path.size());
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            int err = errno;
+            ::close(fd);
+            errno = err;
+            return -1;
+        }
+        return fd;
+    }
+
+    /* Move the partial line to the front of the buffer
+     * (growing the buffer if the line fills it) and read
+     * another block after it. */
+    void refill() {
+        size_t rest = this->size - this->pos;
+        if (rest > 0 && this->pos > 0)
+            memmove(&this->buffer[0], &this->buffer[this->pos], rest);
+        this->pos = 0;
+        this->size = rest;
+        if (this->buffer.size() - rest < STREAM_BLOCK_SIZE / 2)
+            this->buffer.resize(this->buffer.size() * 2);
+        this->data = &this->buffer[0];
+        ssize_t n;
+        do {
+            n = read(this->fd, &this->buffer[rest], this->buffer.size() - rest);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0)
+            logstream(LOG_ERROR) << "Unable to read the stream file: " << this->path << ". Error code: " << strerror(errno) << std::endl;
+        if (n <= 0) {
+            this->failed = n < 0;
+            this->eof = true;
+            return;
+        }
+        this->size += n;
+    }
+
+    std::string path;
+    int fd;
+    const char* data; /* The mapped file or the buffer. */
+    size_t size;      /* Number of valid bytes in data. */
+    size_t pos;       /* Start of the next line in data. */
+    bool mapped;
+    bool live;        /* Whether we read from stdin, a pipe, a FIFO or a socket. */
+    bool eof;         /* Whether data holds the rest of the file. */
+    bool failed;      /* Whether a read failed. */
+    std::vector<char> buffer;
+};
+
+#endif /* __STREAM_READER_HPP__ */
@@ -11,6 +11,7 @@
  *
  */
 
+#include <chrono>
 #include <fstream>
 #include <pthread.h>
 #include <sys/types.h>
@@ -21,7 +22,9 @@
 #include "include/helper.hpp"
 #include "include/def.hpp"
 #include "include/histogram.hpp"
-#include "../extern/extern.hpp"
+#include "include/binary_format.hpp"
+#include "include/stream_reader.hpp"
+#include "include/stream_pipeline.hpp"
 #include "wl.hpp"
 /* GraphChi header files we use. */
 #include "graphchi_basic_includes.hpp"
@@ -29,50 +32,124 @@
 
 using namespace graphchi;
 
-graphchi_dynamicgraph_engine<VertexDataType, EdgeDataType> * dyngraph_engine;
+/* The (K_HOPS, SKETCH_SIZE) combinations compiled into
+ * the binary; the k_hops and sketch_size command line
+ * options pick one of them at startup. If both are set
+ * with -D flags, we only compile that combination. */
+#if defined(K_HOPS) && defined(SKETCH_SIZE)
+#define UNICORN_CONFIGS(X) X(K_HOPS, SKETCH_SIZE)
+#define DEFAULT_K_HOPS K_HOPS
+#define DEFAULT_SKETCH_SIZE SKETCH_SIZE
+#else
+#define UNICORN_CONFIGS(X) \
+    X(1, 500) X(1, 1000) X(1, 2000) \
+    X(2, 500) X(2, 1000) X(2, 2000) \
+    X(3, 500) X(3, 1000) X(3, 2000) \
+    X(4, 500) X(4, 1000) X(4, 2000)
+#define DEFAULT_K_HOPS 3
+#define DEFAULT_SKETCH_SIZE 2000
+#endif
+
 std::string stream_file;
 std::string sketch_file;
-/* The following variables are declared
- * in extern.hpp. They are defined here
- * and will be used in various place in
- * GraphChi and Unicorn. */
-pthread_barrier_t std::graph_barrier;
-pthread_barrier_t std::stream_barrier;
-int std::stop = 0;
-bool std::base_graph_constructed = false;
-bool std::no_new_tasks = false;
+/* Number of threads that parse the stream file, and
+ * how many parsed chunks may wait to be streamed. */
+int parse_threads;
+int parse_window;
+/* Whether to stage the next batch while GraphChi WL computes the current one. */
+bool double_buffer = false;
+/* Release a batch this long after its first edge (0: wait for BATCH edges). */
+int batch_timeout_ms;
 /* The following variables are declared in def.hpp.
  * They are defined here and will be assigned values
  * in the main function. */
 int DECAY;
 float LAMBDA;
+bool LAZY_DECAY = false;
+int HIST_SHARDS;
+bool COUNTER_RNG = false;
 int WINDOW;
 int BATCH;
 bool CHUNKIFY = true;
 int CHUNK_SIZE;
+bool BINARY_RELABEL = false;
+int RADIX_THRESHOLD;
 FILE * SFP;
 #ifdef VIZ
 std::string HIST_FILE;
 #endif
 
+/* The reader thread hands edges to GraphChi in groups of
+ * at most ADD_EDGES_BATCH edges (and at BATCH boundaries). */
+#define ADD_EDGES_BATCH 65536
+
+/*!
+ * @brief Add the @staged edges to the graph and schedule their
+ * vertices (@tasks) in one go, then clear them.
+ */
+template <int KH>
+void flush_edges(graphchi_dynamicgraph_engine<node_label<KH>, edge_label<KH> > * dyngraph_engine,
+                 std::vector<graphchi::created_edge<edge_label<KH> > > &staged, std::vector<vid_t> &tasks) {
+    if (staged.empty())
+        return;
+    /* Blocks until GraphChi has room for the edges. */
+    dyngraph_engine->add_edges(staged.data(), staged.size());
+    /* Schedule the new nodes to be computed.
+     * TODO: probably not needed since we are
+     *       not doing selective scheduling. */
+    dyngraph_engine->add_tasks(tasks.data(), tasks.size());
+    staged.clear();
+    tasks.clear();
+}
+
+/*!
+ * @brief Record the sketch before a new batch of edges is added.
+ * If USEWINDOW is not set, we record a new sketch every BATCH
+ * streaming edges are processed. We also record the first
+ * sketch as the base graph automatically.
+ */
+template <int SK>
+void record_batch_sketch(Histogram<SK>* hist) {
+#ifndef USEWINDOW
+    for (int i = 0; i < SK; i++)
+	fprintf(SFP,"%lu ", hist->get_sketch()[i]);
+    fprintf(SFP, "\n");
+    /* Readers of a live stream's sketches see them now. */
+    fflush(SFP);
+#ifdef VIZ
+    /* We output a histogram file (one histogram per file)
+     * for visualization. */
+    hist->write_histogram();
+#endif
+#endif
+}
+
 /*!
  * @brief A separate thread execute this function to stream graph from a file.
+ * @info is the dynamic graph engine to add the streamed edges to.
  */
+template <int KH, int SK>
 void * dynamic_graph_reader(void * info) {
+    graphchi_dynamicgraph_engine<node_label<KH>, edge_label<KH> > * dyngraph_engine =
+        (graphchi_dynamicgraph_engine<node_label<KH>, edge_label<KH> > *) info;
 #ifdef DEBUG
     logstream(LOG_DEBUG) << "Stream provenance graph from file: " << stream_file << std::endl;
 #endif
-    /* A busy loop to wait until the base graph histogram is constructed. */
-    while(!std::base_graph_constructed) {
+    /* Open the file for streaming. Parser threads start
+     * parsing it now, while the base graph is processed. */
+    StreamReader reader(stream_file);
+    StreamPipeline<KH> pipeline(&reader, parse_threads, parse_window);
+    /* Coordinates us with GraphChi WL. */
+    stream_coordinator* coordinator = stream_coordinator::get_instance();
 #ifdef DEBUG
-        logstream(LOG_DEBUG) << "Waiting for the base graph to be constructed..." << std::endl;
+    logstream(LOG_DEBUG) << "Waiting for the base graph to be constructed..." << std::endl;
 #endif
-        sleep(0);
-    }
-    /* Once breaking out of the loop, we know 
+    /* Block until the base graph histogram is constructed. */
+    coordinator->wait_for_base_graph();
+    /* Once we are woken up, we know
      * the base graph histogram is ready.
      * Get the histogram map singleton. */
-    Histogram* hist = Histogram::get_instance();
+    Histogram<SK>* hist = Histogram<SK>::get_instance();
     /* Initailize the first sketch of the histogram. */
     hist->create_sketch();
     /* If BASESKETCH is set, we record the first sketch
@@ -84,27 +161,75 @@ void * dynamic_graph_reader(void * info) {
 	logstream(LOG_ERROR) << "Sketch file no longer exists..." << std::endl;
     assert(SFP != NULL);
 #ifdef BASESKETCH
-    for (int i = 0; i < SKETCH_SIZE; i++)
+    for (int i = 0; i < SK; i++)
 	fprintf(SFP,"%lu ", hist->get_sketch()[i]);
     fprintf(SFP, "\n");
 #endif
-    /* Open the file for streaming. */
-    FILE * f = fopen(stream_file.c_str(), "r");
-    if (f == NULL)
-        logstream(LOG_ERROR) << "Unable to open the file for streaming: " << stream_file << ". Error code: " << strerror(errno) << std::endl;
-    assert(f != NULL);
-    /* Read the file. */
-    vid_t srcID;
-    vid_t dstID;
-    EdgeDataType e;
-    /* Char buffer to hold each line. */
-    char s[1024];
+    /* The current edge, parsed. */
+    const graphchi::created_edge<edge_label<KH> > *edge = NULL;
+    /* Edges (and their vertices) not added to the graph yet. */
+    std::vector<graphchi::created_edge<edge_label<KH> > > staged;
+    std::vector<vid_t> tasks;
     /* Count the number of batched edges. */
     int cnt = 0;
     /* For synchronization with GraphChi algorithm. */
     bool passed_barrier = false;
 
-    while(fgets(s, 1024, f) != NULL) {
+    /* If batch_timeout_ms is set, a batch is also released
+     * batch_timeout_ms after its first edge arrived, even if
+     * it has fewer than BATCH edges, and the sketch of the
+     * last batch is recorded batch_timeout_ms after the batch
+     * was released even if no new edge has arrived. This
+     * bounds the latency of sketches from a live stream. */
+    typedef std::chrono::steady_clock clock;
+    clock::duration timeout = std::chrono::milliseconds(batch_timeout_ms);
+    clock::time_point deadline = clock::now() + timeout;
+    int ret;
+
+    /* In double-buffered mode, we stage a whole batch (the
+     * shadow buffer) while GraphChi WL computes the previous
+     * one, and add it at once when GraphChi WL hits the
+     * stream_barrier. GraphChi WL then only waits for a
+     * single add_edges() instead of the whole batch to be
+     * read. Batches (and so sketches) are the same. */
+    bool more = double_buffer;
+    while (more) {
+        while (cnt < BATCH) {
+            ret = pipeline.poll_edge(&edge, batch_timeout_ms > 0 && cnt > 0 ? &deadline : NULL);
+            if (ret != STREAM_EDGE) {
+                more = ret != STREAM_END;
+                break;
+            }
+            if (edge->src == edge->dst) {
+#ifdef DEBUG
+                logstream(LOG_ERROR) << "Ignore an edge because it is a self-loop: " << edge->src << "<->" << edge->dst <<std::endl;
+#endif
+                continue;
+            }
+            staged.push_back(*edge);
+            tasks.push_back(edge->src);
+            tasks.push_back(edge->dst);
+            if (++cnt == 1)
+                deadline = clock::now() + timeout;
+        }
+        if (cnt == 0)
+            break;
+        coordinator->wait_stream_barrier();
+        record_batch_sketch<SK>(hist);
+        flush_edges<KH>(dyngraph_engine, staged, tasks);
+        if (!more)
+            break; /* The leftover edges are handled below. */
+        cnt = 0;
+        coordinator->wait_graph_barrier();
+    }
+
+    while (!double_buffer) {
+        /* We wait for the first edge of a batch until the sketch
+         * is due, and for the others until the batch is due. */
+        bool timed = batch_timeout_ms > 0 && (cnt > 0 || !passed_barrier);
+        ret = pipeline.poll_edge(&edge, timed ? &deadline : NULL);
+        if (ret == STREAM_END)
+            break;
         /* We add more edges for the GraphChi WL to compute, but we
          * will wait until all the previously added edges have finished
          * before we add new ones. */
@@ -113,139 +238,62 @@ void * dynamic_graph_reader(void * info) {
 	     * GraphChi WL hits the same stream_barrier (when it
 	     * finishes the current batch for all nodes), and
 	     * then we will start streaming new edges. */
-            pthread_barrier_wait(&std::stream_barrier);
-	    /* If USEWINDOW is not set, we record a new sketch
-	     * every BATCH streaming edges are processed. We
-	     * also record the first sketch as the base graph
-	     * automatically. */
-#ifndef USEWINDOW
-	    for (int i = 0; i < SKETCH_SIZE; i++)
-		fprintf(SFP,"%lu ", hist->get_sketch()[i]);
-	    fprintf(SFP, "\n");
-#ifdef VIZ
-	    /* We output a histogram file (one histogram per file)
-	     * for visualization. */
-	    hist->write_histogram();
-#endif
-#endif
+            coordinator->wait_stream_barrier();
+	    record_batch_sketch<SK>(hist);
         }
         passed_barrier = true;
-	FIXLINE(s);
-        /* Parse the line. */
-        char delims[] = ":\t ";
-        unsigned char *t;
-        char *k;
-
-	/* Obtain source node ID. */
-        k = strtok(s, delims);
-        if (k == NULL)
-            logstream(LOG_ERROR) << "Source ID is missing." << std::endl;
-        assert(k != NULL);
-        srcID = atoi(k);
-
-	/* Obtain destination node ID. */
-        k = strtok(NULL, delims);
-        if (k == NULL)
-            logstream(LOG_ERROR) << "Destination ID is missing." << std::endl;
-        assert(k != NULL);
-        dstID = atoi(k);
-
-	/* Populate EdgeDataType for the edge. */
-        e.itr = 0; /* new itr count is always 0. */
-        t = (unsigned char *)strtok(NULL, delims);
-        if (t == NULL)
-            logstream(LOG_ERROR) << "Source label is missing." << std::endl;
-        assert(t != NULL);
-        e.src[0] = hash(t);
-
-        t = (unsigned char *)strtok(NULL, delims);
-        if (t == NULL)
-            logstream(LOG_ERROR) << "Destination label is missing." << std::endl;
-        assert (t != NULL);
-        e.dst = hash(t);
-
-        t = (unsigned char *)strtok(NULL, delims);
-        if (t == NULL)
-            logstream(LOG_ERROR) << "Edge label is missing." << std::endl;
-        assert (t != NULL);
-        e.edg = hash(t);
-
-        k = strtok(NULL, delims);
-        if (k == NULL)
-            logstream(LOG_ERROR) << "New_src info is missing." << std::endl;
-        assert(k != NULL);
-        int new_src = atoi(k);
-        if (new_src == 1)
-            e.new_src = true;
-        else
-            e.new_src = false;
-
-        k = strtok(NULL, delims);
-        if (k == NULL)
-            logstream(LOG_ERROR) << "New_dst info is missing." << std::endl;
-        assert(k != NULL);
-        int new_dst = atoi(k);
-        if (new_dst == 1)
-            e.new_dst = true;
-        else
-            e.new_dst = false;
-
-        k = strtok(NULL, delims);
-        if (k == NULL)
-            logstream(LOG_ERROR) << "Time is missing." << std::endl;
-        assert (k != NULL);
-        e.tme[0] = strtoul(k, NULL, 10);
-
+        if (ret == STREAM_EDGE) {
+            vid_t srcID = edge->src;
+            vid_t dstID = edge->dst;
+            if (srcID == dstID) {
 #ifdef DEBUG
-        k = strtok(NULL, delims);
-        if (k != NULL)
-            logstream(LOG_DEBUG) << "Extra info in the edge is ignored." << std::endl;
+                logstream(LOG_ERROR) << "Ignore an edge because it is a self-loop: " << srcID << "<->" << dstID <<std::endl;
 #endif
-        if (srcID == dstID) {
+                continue;
+            }
+            /* Stage the new edge to be added to the graph. */
+            staged.push_back(*edge);
+            tasks.push_back(srcID);
+            tasks.push_back(dstID);
+            if (++cnt == 1)
+                deadline = clock::now() + timeout;
 #ifdef DEBUG
-            logstream(LOG_ERROR) << "Ignore an edge because it is a self-loop: " << srcID << "<->" << dstID <<std::endl;
+            logstream(LOG_DEBUG) << "Schedule a new edge: " << srcID << " -> " << dstID << std::endl;
 #endif
-            continue;
+            if (cnt == BATCH || staged.size() == ADD_EDGES_BATCH)
+                flush_edges<KH>(dyngraph_engine, staged, tasks);
         }
-        /* Add the new edge to the graph. */
-        bool success = false;
-	/* Try to add until it is successful. */
-        while (!success)
-            success = dyngraph_engine->add_edge(srcID, dstID, e);
-        ++cnt;
-        /* Schedule the new nodes to be computed. 
-         * TODO: probably not needed since we are
-	 *       not doing selective scheduling. */
-        dyngraph_engine->add_task(srcID);
-        dyngraph_engine->add_task(dstID);
-#ifdef DEBUG
-        logstream(LOG_DEBUG) << "Schedule a new edge: " << srcID << " -> " << dstID << std::endl;
-#endif
-        if (cnt == BATCH) {
-            /* We continue to add new edges until INTERVAL edges are added.
-	     * When we are in this block, we have added INTERVAL edges and
-	     * we can now let GraphChi WL starts its computation. */
+        if (cnt == BATCH || (ret == STREAM_TIMEOUT && cnt > 0)) {
+            /* We continue to add new edges until INTERVAL edges are added
+	     * (or the batch is due). When we are in this block, we have
+	     * added the batch and we can now let GraphChi WL starts its
+	     * computation. */
+            flush_edges<KH>(dyngraph_engine, staged, tasks);
             cnt = 0;
             passed_barrier = false;
+            deadline = clock::now() + timeout;
 	    /* GraphChi WL would be waiting for us to hit this
 	     * graph_barrier barrier. Once we hit this barrier,
 	     * GraphChi WL will resume its execution on our
 	     * newly added nodes and edges. */
-            pthread_barrier_wait(&std::graph_barrier);
+            coordinator->wait_graph_barrier();
         }
     }
+    flush_edges<KH>(dyngraph_engine, staged, tasks);
     /* Signal to GraphChi WL that we have streamed all the edges. 
      * So when GraphChi WL finishes computation, it will stop. */
-    std::stop = 1;
-    if (cnt != 0) {
+    coordinator->set_stop();
+    if (cnt != 0 || passed_barrier) {
 	    /* This block handles leftover edges that do not
 	     * hit INTERVAL in the previous loop. We still
-	     * want GraphChi WL to process them. */
-	    pthread_barrier_wait(&std::graph_barrier);
+	     * want GraphChi WL to process them. GraphChi WL
+	     * also waits for us if we passed the stream_barrier
+	     * without adding any edges. */
+	    coordinator->wait_graph_barrier();
     }
 
     /* We are done. Close the stream file. */
-    if (ferror(f) != 0 || fclose(f) != 0) {
+    if (!reader.close()) {
         logstream(LOG_ERROR) << "Unable to close the stream file: " << stream_file << ". Error code: " << strerror(errno) << std::endl;
 	return NULL;
     }
@@ -253,6 +301,58 @@ void * dynamic_graph_reader(void * info) {
     return NULL;
 }
 
+/*!
+ * @brief Build the base graph, stream the rest of the graph
+ * and generate sketches, for KH hops and sketch size SK.
+ */
+template <int KH, int SK>
+void run_unicorn(std::string base_file, int niters, bool scheduler, metrics &m) {
+#ifdef COMPACT_EDGES
+    /* Shards hold label IDs, so we need the dictionary
+     * saved with them (if they are already preprocessed). */
+    LabelDictionary* dict = LabelDictionary::get_instance();
+    std::string dict_file = base_file + ".labeldict";
+    if (dict->load(dict_file))
+        logstream(LOG_INFO) << "Loaded " << dict->size() << " labels from " << dict_file << std::endl;
+#endif
+    /* Process input file - if not already preprocessed */
+    int nshards = convert_base_if_notexists<KH>(base_file, get_option_string("nshards", "auto"));
+#ifdef COMPACT_EDGES
+    if (!dict->save(dict_file))
+        assert(false);
+#endif
+
+    /* Create the engine object. */
+    graphchi_dynamicgraph_engine<node_label<KH>, edge_label<KH> > * dyngraph_engine =
+        new graphchi_dynamicgraph_engine<node_label<KH>, edge_label<KH> >(base_file, nshards, scheduler, m);
+
+    /* Start streaming thread. */
+    pthread_t strthread;
+    int ret = pthread_create(&strthread, NULL, dynamic_graph_reader<KH, SK>, dyngraph_engine);
+    assert(ret >= 0);
+
+    /* Run the engine */
+    WeisfeilerLehman<KH, SK> program;
+    dyngraph_engine->run(program, niters);
+
+    /* Once streaming is done, we will record the last 
+     * sketch that describes the entire graph. */
+    /* We append the last sketch to the sketch file. */
+    Histogram<SK>* hist = Histogram<SK>::get_instance();
+#ifdef DEBUG
+    logstream(LOG_DEBUG) << "Recording the final graph sketch..." << std::endl;
+#endif
+    if (SFP == NULL)
+        logstream(LOG_ERROR) << "Sketch file no longer exists..." << std::endl;
+    assert(SFP != NULL);
+    hist->record_sketch(SFP);
+#ifdef COMPACT_EDGES
+    /* The engine wrote new label IDs to the shards. */
+    if (!dict->save(dict_file))
+        assert(false);
+#endif
+}
+
 /* Run the program using command line on the graphchi-cpp directory:
  * bin/streaming/main file streaming/test.data niters 1000 stream_file streaming/stream.data
  * Compile the program:
@@ -285,11 +385,24 @@ int main(int argc, const char ** argv) {
     int niters = get_option_int("niters", 1000000);
     bool scheduler = true;	/* We always use GraphChi scheduler. */
     stream_file = get_option_string("stream");
+    parse_threads = get_option_int("parse_threads", 1);
+    parse_window = get_option_int("parse_window", 4 * parse_threads);
+    double_buffer = get_option_int("double_buffer", 0) != 0;
+    batch_timeout_ms = get_option_int("batch_timeout_ms", 0);
     /* More parameters from the command line to configure
      * hyperparameters of feature vector generation. Those
      * variables are declared extern somewhere else. */
     DECAY = get_option_int("decay", 10);
     LAMBDA = get_option_float("lambda", 0.02);	
+    int to_lazy_decay = get_option_int("lazy_decay", 0);
+    if (to_lazy_decay) LAZY_DECAY = true;
+    HIST_SHARDS = get_option_int("hist_shards", 1);
+    std::string param_rng = get_option_string("param_rng", "libc");
+    if (param_rng == "counter") COUNTER_RNG = true;
+    else if (param_rng != "libc") {
+        logstream(LOG_ERROR) << "Unknown param_rng: " << param_rng << ". Use libc or counter." << std::endl;
+        assert(false);
+    }
     BATCH = get_option_int("batch", 1000);
     WINDOW = get_option_int("window", 500);
     sketch_file = get_option_string("sketch");
@@ -299,6 +412,15 @@ int main(int argc, const char ** argv) {
     int to_chunk = get_option_int("chunkify", 1);
     if (!to_chunk) CHUNKIFY = false;
     CHUNK_SIZE = get_option_int("chunk_size", 5);
+    std::string relabel = get_option_string("relabel", "string");
+    if (relabel == "binary") BINARY_RELABEL = true;
+    else if (relabel != "string") {
+        logstream(LOG_ERROR) << "Unknown relabel: " << relabel << ". Use string or binary." << std::endl;
+        assert(false);
+    }
+    RADIX_THRESHOLD = get_option_int("radix_threshold", 0);
+    int k_hops = get_option_int("k_hops", DEFAULT_K_HOPS);
+    int sketch_size = get_option_int("sketch_size", DEFAULT_SKETCH_SIZE);
 
     /* Open the sketch file to write. */
     SFP = fopen(sketch_file.c_str(), "a");
@@ -307,51 +429,28 @@ int main(int argc, const char ** argv) {
     }
     assert(SFP != NULL);
 
-    /* Process input file - if not already preprocessed */
-    int nshards = convert_if_notexists<EdgeDataType>(base_file, get_option_string("nshards", "auto"));
-
-    /* Create the engine object. */
-    dyngraph_engine = new graphchi_dynamicgraph_engine<VertexDataType, EdgeDataType>(base_file, nshards, scheduler, m); 
-
-    /* Initialize barrier. */
-    pthread_barrier_init(&std::stream_barrier, NULL, 2);
-    pthread_barrier_init(&std::graph_barrier, NULL, 2);
-
-    /* Start streaming thread. */
-    pthread_t strthread;
-    int ret = pthread_create(&strthread, NULL, dynamic_graph_reader, NULL);
-    assert(ret >= 0);
-
-    /* Run the engine */
-    WeisfeilerLehman program;
-    dyngraph_engine->run(program, niters);
+    /* Run with the compiled-in combination that matches the options. */
+    bool found = false;
+#define RUN_UNICORN(kh, sk) \
+    if (!found && k_hops == kh && sketch_size == sk) { \
+        found = true; \
+        run_unicorn<kh, sk>(base_file, niters, scheduler, m); \
+    }
+    UNICORN_CONFIGS(RUN_UNICORN)
+#undef RUN_UNICORN
+    if (!found) {
+#define LOG_CONFIG(kh, sk) << " (" << kh << ", " << sk << ")"
+        logstream(LOG_ERROR) << "Unsupported k_hops " << k_hops << " and sketch_size " << sketch_size
+                             << ". Supported (k_hops, sketch_size):" UNICORN_CONFIGS(LOG_CONFIG) << std::endl;
+#undef LOG_CONFIG
+        assert(false);
+    }
 
-    /* Once streaming is done, we will record the last 
-     * sketch that describes the entire graph. */
-    /* We append the last sketch to the sketch file. */
-    Histogram* hist = Histogram::get_instance();
-#ifdef DEBUG
-    logstream(LOG_DEBUG) << "Recording the final graph sketch..." << std::endl;
-#endif
-    if (SFP == NULL)
-        logstream(LOG_ERROR) << "Sketch file no longer exists..." << std::endl;
-    assert(SFP != NULL);
-    hist->record_sketch(SFP);
     /* Once we are done, we close the sketch file. */
     if (ferror(SFP) != 0 || fclose(SFP) != 0) {
         logstream(LOG_ERROR) << "Unable to close the sketch file: " << sketch_file <<  std::endl;
         return -1;
     }
-
-    /* Release the barrier resources. */
-    int ret_stream = pthread_barrier_destroy(&std::stream_barrier);
-    int ret_graph = pthread_barrier_destroy(&std::graph_barrier);
-    if (ret_stream == EBUSY) {
-        logstream(LOG_ERROR) << "Resource stream_barrier cannot be destroyed." << std::endl;
-    }
-    if (ret_graph == EBUSY) {
-        logstream(LOG_ERROR) << "Resource graph_barrier cannot be destroyed." << std::endl;
-    }
 #ifdef DEBUG
     metrics_report(m);
 #endif
@@ -0,0 +1,92 @@
+/*
+ *
+ * Author: Xueyuan Han <hanx@g.harvard.edu>
+ *
+ * Copyright (C) 2018-2020 Harvard University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ */
+
+/* Accuracy check of the compact sketch parameter store
+ * (COMPACT_PARAMS) against the full double-precision
+ * tables. It reports the relative error of hash values,
+ * and how often the two stores pick the same label for
+ * a sketch slot on random histograms. */
+
+#if !defined(MEMORY) || !defined(SKETCH_SIZE)
+#error "param_check must be compiled with -DMEMORY and -DSKETCH_SIZE=<SIZE>"
+#endif
+
+#include <cmath>
+#include <random>
+#include <vector>
+/* Unicorn header files we use. */
+#include "include/def.hpp"
+#include "include/sketch_params.hpp"
+/* GraphChi header files we use. */
+#include "graphchi_basic_includes.hpp"
+#include "logger/logger.hpp"
+
+using namespace graphchi;
+
+int main(int argc, const char ** argv) {
+    graphchi_init(argc, argv);
+    global_logger().set_log_level(LOG_INFO);
+
+    int nhistograms = get_option_int("histograms", 100);
+    int nlabels = get_option_int("labels", 1000);
+    double max_value = get_option_float("max_value", 1000);
+
+    FullSketchParams<SKETCH_SIZE>* full = new FullSketchParams<SKETCH_SIZE>();
+    CompactSketchParams<SKETCH_SIZE>* compact = new CompactSketchParams<SKETCH_SIZE>();
+    logstream(LOG_INFO) << "Full tables: " << FullSketchParams<SKETCH_SIZE>::bytes() / (1 << 20) << " MB; compact tables: "
+                        << CompactSketchParams<SKETCH_SIZE>::bytes() / (1 << 20) << " MB" << std::endl;
+    full->generate();
+    compact->generate();
+
+    std::default_random_engine generator(36);
+    std::uniform_int_distribution<int> pos_dist(0, PREGEN - 1);
+    std::uniform_real_distribution<double> value_dist(1e-3, max_value);
+
+    double max_error = 0, sum_error = 0;
+    long nerrors = 0, agree = 0, nslots = 0;
+    std::vector<double> full_min(SKETCH_SIZE), compact_min(SKETCH_SIZE);
+    std::vector<int> full_arg(SKETCH_SIZE), compact_arg(SKETCH_SIZE);
+    for (int h = 0; h < nhistograms; h++) {
+        for (int l = 0; l < nlabels; l++) {
+            int pos1 = pos_dist(generator);
+            int pos2 = pos_dist(generator);
+            double value = value_dist(generator);
+            for (int i = 0; i < SKETCH_SIZE; i++) {
+                double a = full->hash_value(pos1, pos2, i, value);
+                double b = compact->hash_value(pos1, pos2, i, value);
+                double error = fabs(a - b) / a;
+                if (error > max_error) max_error = error;
+                sum_error += error;
+                nerrors++;
+                if (l == 0 || a < full_min[i]) {
+                    full_min[i] = a;
+                    full_arg[i] = l;
+                }
+                if (l == 0 || b < compact_min[i]) {
+                    compact_min[i] = b;
+                    compact_arg[i] = l;
+                }
+            }
+        }
+        for (int i = 0; i < SKETCH_SIZE; i++)
+            if (full_arg[i] == compact_arg[i]) agree++;
+        nslots += SKETCH_SIZE;
+    }
+    logstream(LOG_INFO) << "Hash value relative error: max " << max_error << ", mean " << sum_error / nerrors << std::endl;
+    logstream(LOG_INFO) << "Sketch slots that pick the same label: " << agree << " / " << nslots
+                        << " (" << 100.0 * agree / nslots << "%)" << std::endl;
+
+    delete full;
+    delete compact;
+    return 0;
+}
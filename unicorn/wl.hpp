@@ -22,19 +22,23 @@
 /* GraphChi header files. */
 #include "graphchi_basic_includes.hpp"
 #include "engine/dynamic_graphs/graphchi_dynamicgraph_engine.hpp"
+#include "engine/stream_coordinator.hpp"
 #include "logger/logger.hpp"
 /* Unicorn header files. */
-#include "../extern/extern.hpp"
 #include "include/def.hpp"
 #include "include/helper.hpp"
 #include "include/histogram.hpp"
 
 namespace graphchi {
     /* GraphChi programs need to subclass GraphChiProgram<vertex-type, edge-type> 
-     * class. The main logic is usually in the update function. */
-    struct WeisfeilerLehman : public GraphChiProgram<VertexDataType, EdgeDataType> {
+     * class. The main logic is usually in the update function.
+     * KH is the number of hops (K_HOPS) and SK the sketch size. */
+    template <int KH, int SK>
+    struct WeisfeilerLehman : public GraphChiProgram<node_label<KH>, edge_label<KH> > {
+        typedef node_label<KH> VertexDataType;
+        typedef edge_label<KH> EdgeDataType;
         /* Get the histogram singleton. */
-        Histogram* hist = Histogram::get_instance();
+        Histogram<SK>* hist = Histogram<SK>::get_instance();
 
         /* Vertex update function. */
         void update(graphchi_vertex<VertexDataType, EdgeDataType> &vertex, graphchi_context &gcontext) {
@@ -53,7 +57,7 @@ namespace graphchi {
 
 		if (vertex.num_inedges() > 0) {
 		    graphchi_edge<EdgeDataType> * edge = vertex.inedge(0); /* Use the first inedge to get its original label. */
-		    nl.lb[0] = edge->get_data().dst;
+		    nl.lb[0] = edge->get_data().get_dst();
 		    nl.is_leaf = false;
 
 		    for (int i = 0; i < vertex.num_inedges(); i++) {
@@ -66,7 +70,7 @@ namespace graphchi {
 		    /* If it does not have any incoming neighbors. Then
 		     * it must have at least one out-going neighbor. */
                     graphchi_edge<EdgeDataType> * edge = vertex.random_outedge();
-                    nl.lb[0] = edge->get_data().src[0];
+                    nl.lb[0] = edge->get_data().get_src(0);
                     nl.is_leaf = true;
 		}
 		nl.tm[0] = 0; /* The first timestamp associated with a vertex is always zero. */
@@ -82,7 +86,7 @@ namespace graphchi {
 #ifdef DEBUG
 		logstream(LOG_DEBUG) << "Original Label (" << vertex.id() << "): " << nl.lb[0] << std::endl;
 #endif
-            } else if (gcontext.iteration < K_HOPS + 1){	/* we know after K_HOPS iterations, we will be done with the base graph. */
+            } else if (gcontext.iteration < KH + 1){	/* we know after K_HOPS iterations, we will be done with the base graph. */
                 /* After the first iteration, all nodes in the base graph are initialized. 
                  * All edges in the base graph should have "itr" >= 1. */
 #ifdef DEBUG
@@ -100,12 +104,15 @@ namespace graphchi {
 		 * will not be added to the graph. If CHUNKIFY is set, we will also segment
 		 * the concatenated string. That is, we may add multiple entries to the map 
 		 * for one string. */
-                std::vector<EdgeDataType> neighborhood; /* We reuse edge_label struct vector to store the neighborhood values. */
+                /* We keep the neighborhood values we need in a per-thread buffer that we reuse. */
+                static thread_local std::vector<NeighborKey> neighborhood;
+                static thread_local NeighborhoodScratch scratch;
+                neighborhood.clear();
 		for (int i = 0; i < vertex.num_inedges(); i++) {
                     graphchi_edge<EdgeDataType> * in_edge = vertex.inedge(i);
 		    EdgeDataType el = in_edge->get_data();
 		    assert(el.itr == gcontext.iteration);	/* During base graph iteration, edge itr value should be the same as gcontext iteration value before the update. */
-		    neighborhood.push_back(el);
+		    neighborhood.push_back(NeighborKey(el.get_tme(gcontext.iteration - 1), el.get_src(gcontext.iteration - 1), el.get_edg()));
 		    /* We will use those edges so increment the itr count by 1 and update the edge. */
 		    el.itr++;
 		    in_edge->set_data(el);
@@ -131,72 +138,37 @@ namespace graphchi {
 		    for (int i = 0; i < vertex.num_outedges(); i++) {
 			graphchi_edge<EdgeDataType> * out_edge = vertex.outedge(i);
 			EdgeDataType el = out_edge->get_data();
-			el.src[gcontext.iteration] = last_itr_label;
+			el.set_src(gcontext.iteration, last_itr_label);
 			/* Time stamp does not change for nodes with no in-coming neighbors. */
-			el.tme[gcontext.iteration] = el.tme[gcontext.iteration - 1]; 
+			el.set_tme(gcontext.iteration, el.get_tme(gcontext.iteration - 1)); 
 			out_edge->set_data(el);
 		    }
 		} else {
 		    /* We first sort the labels based on the timestamps of the in_edges.
 		     * Note that the neighborhood only contains edges of the base graph. */
-		    std::sort(neighborhood.begin(), neighborhood.end(), EdgeSorter(gcontext.iteration - 1));
-		    /* First construct the string of the vertex itself. */
-		    std::string new_label_str = "";
-		    std::string first_str;
-		    std::stringstream first_out;
-		    first_out << vertex.get_data().lb[gcontext.iteration - 1];
-		    first_str = first_out.str();
-		    new_label_str += first_str; /* Use space to separate number strings. */
-		    /* Then append neighborhood labels. */
-		    for (std::vector<EdgeDataType>::iterator it = neighborhood.begin(); it != neighborhood.end(); ++it) {
-			if (gcontext.iteration == 1) { /* The first iteration includes edge labels. */
-			    std::string edge_str;
-			    std::stringstream edge_out;
-			    edge_out << it->edg;
-			    edge_str = edge_out.str();
-			    new_label_str += " " + edge_str;
-			}
-			std::string node_str;
-			std::stringstream node_out;
-			node_out << it->src[gcontext.iteration - 1];
-			node_str = node_out.str();
-			new_label_str += " " + node_str;
-		    }
-#ifdef DEBUG
-		    logstream(LOG_DEBUG) << "New label string of vertex (" << vertex.id() << "): " << new_label_str << std::endl;
-#endif
-		    /* Relabel by hashing. */
-		    unsigned long new_label = hash((unsigned char *)new_label_str.c_str());
-		    /* Populate the histogram, depending if we CHUNKIFY or not. */
-		    if (!CHUNKIFY) {
-			hist->update(new_label, true);
-		    } else {
-			std::vector<unsigned long> to_insert = chunkify((unsigned char *)new_label_str.c_str(), CHUNK_SIZE);
-			for (std::vector<unsigned long>::iterator ti = to_insert.begin(); ti != to_insert.end(); ++ti)
-			    hist->update(*ti, true);
-		    }
-#ifdef DEBUG
-		    logstream(LOG_DEBUG) << "New label of vertex (" << vertex.id() << "): " << new_label << std::endl;
-#endif
+		    sort_neighborhood(neighborhood, scratch);
+		    /* Relabel and populate the histogram. */
+		    unsigned long new_label = this->relabel(vertex.id(), vertex.get_data().lb[gcontext.iteration - 1], neighborhood,
+							   gcontext.iteration == 1, true);
 		    /* Update the vertex's label*/
 		    nl.lb[gcontext.iteration] = new_label;
-		    nl.tm[gcontext.iteration] = neighborhood[0].tme[gcontext.iteration - 1];
+		    nl.tm[gcontext.iteration] = neighborhood[0].tme;
 		    vertex.set_data(nl);
 		    /* Update its out-going edges.*/
 		    for (int i = 0; i < vertex.num_outedges(); i++) {
 			graphchi_edge<EdgeDataType> * out_edge = vertex.outedge(i);
 			EdgeDataType el = out_edge->get_data();
-			el.src[gcontext.iteration] = new_label;
+			el.set_src(gcontext.iteration, new_label);
 			/* Time stamp is the same as the vertex's timestamp,
 			 * i.e., the smallest one among all in-coming neighbors. */
-			el.tme[gcontext.iteration] = neighborhood[0].tme[gcontext.iteration - 1];
+			el.set_tme(gcontext.iteration, neighborhood[0].tme);
 			out_edge->set_data(el);
 		    }
 		}
 		/* Always schedule itself for the next iteration,
 		 * until the base graph is completely processed. */
 		if (gcontext.scheduler != NULL) {
-		    if (gcontext.iteration < K_HOPS)
+		    if (gcontext.iteration < KH)
 			/* Do not schedule for the next iteration during the K_HOPSth iteration
 			 * because all nodes in the base graph should have been processed. */
 			gcontext.scheduler->add_task(vertex.id());
@@ -236,12 +208,12 @@ namespace graphchi {
 			assert(out_edge != NULL);
 			EdgeDataType el = out_edge->get_data();
 			VertexDataType nl;
-			nl.lb[0] = el.src[0];
+			nl.lb[0] = el.get_src(0);
 			nl.tm[0] = 0;
 			/* Since the node has no incoming edges, all of its labels 
 			 * are the same as the initial label. All of its timestamps
 			 * are set to 0. */
-			for (int i = 1; i < K_HOPS + 1; i++) {
+			for (int i = 1; i < KH + 1; i++) {
 			    nl.lb[i] = nl.lb[0];
 			    nl.tm[i] = 0;
 			}
@@ -249,7 +221,7 @@ namespace graphchi {
 			/* Update node label. */
 			vertex.set_data(nl);
 			/* Populate the histogram for all its labels (hops). */
-			for (int i = 0; i < K_HOPS + 1; i++) {
+			for (int i = 0; i < KH + 1; i++) {
 			    hist->decay(SFP);
 			    hist->update(nl.lb[i], false);
 			}
@@ -257,10 +229,10 @@ namespace graphchi {
 			for (int i = 0; i < vertex.num_outedges(); i++) {
 			    graphchi_edge<EdgeDataType> * out_edge = vertex.outedge(i);
 			    EdgeDataType el = out_edge->get_data();
-			    for (int j = 1; j < K_HOPS + 1; j++) {
-				el.src[j] = nl.lb[j];
+			    for (int j = 1; j < KH + 1; j++) {
+				el.set_src(j, nl.lb[j]);
 				/* Update the timestamps. */
-				el.tme[j] = el.tme[j - 1];
+				el.set_tme(j, el.get_tme(j - 1));
 			    }
 			    el.new_src = false; /* Make sure every edge is marked as seen. */
 			    out_edge->set_data(el);
@@ -274,7 +246,7 @@ namespace graphchi {
 #endif
 			graphchi_edge<EdgeDataType> * edge = vertex.inedge(0);
 			VertexDataType nl = vertex.get_data();
-			nl.lb[0] = edge->get_data().dst;
+			nl.lb[0] = edge->get_data().get_dst();
 			nl.tm[0] = 0;
 			vertex.set_data(nl);
 			
@@ -317,9 +289,9 @@ namespace graphchi {
 		    for (int i = 0; i < vertex.num_outedges(); i++) {
 			graphchi_edge<EdgeDataType> * out_edge = vertex.outedge(i);
 			EdgeDataType el = out_edge->get_data();
-			for (int j = 1; j < K_HOPS + 1; j++) {
-			    el.src[j] = nl.lb[j];
-			    el.tme[j] = el.tme[j - 1];
+			for (int j = 1; j < KH + 1; j++) {
+			    el.set_src(j, nl.lb[j]);
+			    el.set_tme(j, el.get_tme(j - 1));
 			}
 			out_edge->set_data(el);
 		    }
@@ -340,15 +312,15 @@ namespace graphchi {
 		    for (int i = 0; i < vertex.num_outedges(); i++) {
 			graphchi_edge<EdgeDataType> * out_edge = vertex.outedge(i);
 			EdgeDataType el = out_edge->get_data();
-			for (int j = 1; j < K_HOPS + 1; j++) {
-			    el.src[j] = nl.lb[j];
-			    el.tme[j] = nl.tm[j];
+			for (int j = 1; j < KH + 1; j++) {
+			    el.set_src(j, nl.lb[j]);
+			    el.set_tme(j, nl.tm[j]);
 			}
 			out_edge->set_data(el);
 		    }
 		    /* Change all incoming edges whose itr count is 0 to 1.
 		     * At the same time, find the minimum itr among all inedges.*/
-		    int min_itr = K_HOPS + 2; /* no itr value in our K_HOPS-hop case can be larger than K_HOPS + 2. */
+		    int min_itr = KH + 2; /* no itr value in our K_HOPS-hop case can be larger than K_HOPS + 2. */
 		    for (int i = 0; i < vertex.num_inedges(); i++) {
 			graphchi_edge<EdgeDataType> * in_edge = vertex.inedge(i);
 			EdgeDataType el = in_edge->get_data();
@@ -361,70 +333,31 @@ namespace graphchi {
 		    }
 		    /* We check here since the minimum iteration value
 		     * should be at least 1, but less than K_HOPS + 2. */
-		    assert(min_itr > 0 && min_itr < K_HOPS + 2);
+		    assert(min_itr > 0 && min_itr < KH + 2);
 #ifdef DEBUG
 		    logstream(LOG_DEBUG) << "The min_itr of the vertex (" << vertex.id() << ") is: " << min_itr << std::endl;
 #endif
-		    if (min_itr == K_HOPS + 1)
+		    if (min_itr == KH + 1)
 			/* This node should not be scheduled again and do not run the rest of the logic.
 			 * This node could be, for example, the source node of a new edge added. */
 			return;
 		    /* Now we update a new label. */
-		    std::vector<EdgeDataType> neighborhood;
+		    static thread_local std::vector<NeighborKey> neighborhood;
+		    static thread_local NeighborhoodScratch scratch;
+		    neighborhood.clear();
 		    for (int i = 0; i < vertex.num_inedges(); i++) {
 			graphchi_edge<EdgeDataType> * in_edge = vertex.inedge(i);
 			EdgeDataType el = in_edge->get_data();
-			neighborhood.push_back(el);
-			if (el.itr < K_HOPS + 1)
+			neighborhood.push_back(NeighborKey(el.get_tme(min_itr - 1), el.get_src(min_itr - 1), el.get_edg()));
+			if (el.itr < KH + 1)
 			    el.itr++; /* We increment edges whose itr value is less than K_HOPS + 1. */
 			in_edge->set_data(el);
 		    }
-		    std::sort(neighborhood.begin(), neighborhood.end(), EdgeSorter(min_itr - 1));
-		    /* First construct the string of the vertex itself. */
-		    std::string new_label_str = "";
-		    std::string first_str;
-		    std::stringstream first_out;
-		    first_out << vertex.get_data().lb[min_itr - 1];
-		    first_str = first_out.str();
-		    new_label_str += first_str; /* Use space to separate number strings. */
-		    /* Then append neighborhood labels. */
-		    for (std::vector<EdgeDataType>::iterator it = neighborhood.begin(); it != neighborhood.end(); ++it) {
-			if (min_itr == 1) { /* If the vertex is incorporating a new edge. */
-			    std::string edge_str;
-			    std::stringstream edge_out;
-			    edge_out << it->edg;
-			    edge_str = edge_out.str();
-			    new_label_str += " " + edge_str;
-			}
-			std::string node_str;
-			std::stringstream node_out;
-			node_out << it->src[min_itr - 1];
-			node_str = node_out.str();
-			new_label_str += " " + node_str;
-		    }
-#ifdef DEBUG
-		    logstream(LOG_DEBUG) << "New label string of the vertex (" << vertex.id() << "): " << new_label_str << std::endl;
-#endif
-		    /* Relabel by hashing. */
-		    unsigned long new_label = hash((unsigned char *)new_label_str.c_str());
-#ifdef DEBUG
-		    logstream(LOG_DEBUG) << "New label of the vertex (" << vertex.id() << "): " << new_label << std::endl;
-#endif
-		    /* Populate the histogram. */
-		    if (!CHUNKIFY) {
-			hist->decay(SFP);
-			hist->update(new_label, false);
-		    } else {
-			std::vector<unsigned long> to_insert = chunkify((unsigned char *)new_label_str.c_str(), CHUNK_SIZE);
-			bool first = true;
-			for (std::vector<unsigned long>::iterator ti = to_insert.begin(); ti != to_insert.end(); ++ti) {
-			    if (first) {
-				hist->decay(SFP);  /* Only decay once. */
-				first = false;
-			    }
-			    hist->update(*ti, false);
-			}
-		    }
+		    sort_neighborhood(neighborhood, scratch);
+		    /* Relabel and populate the histogram. min_itr == 1
+		     * if the vertex is incorporating a new edge. */
+		    unsigned long new_label = this->relabel(vertex.id(), vertex.get_data().lb[min_itr - 1], neighborhood,
+							   min_itr == 1, false);
 		    /* Update the vertex's label*/
 		    nl.lb[min_itr] = new_label;
 		    vertex.set_data(nl);
@@ -433,15 +366,15 @@ namespace graphchi {
 		    for (int i = 0; i < vertex.num_outedges(); i++) {
 			graphchi_edge<EdgeDataType> * out_edge = vertex.outedge(i);
 			EdgeDataType el = out_edge->get_data();
-			el.src[min_itr] = new_label;
+			el.set_src(min_itr, new_label);
 			/* Time stamp is the smallest one among
 			 * all of its in-coming neighbors. */
-			el.tme[min_itr] = neighborhood[0].tme[min_itr - 1];
+			el.set_tme(min_itr, neighborhood[0].tme);
 			/* Update the itr value. */
 #ifdef DEBUG
 			logstream(LOG_DEBUG) << "Outgoing vertex (" << out_edge->vertex_id() << ") current itr:" << el.itr << std::endl;
 #endif
-			if (el.itr == K_HOPS + 1) {
+			if (el.itr == KH + 1) {
 			    /* We only need to update those nodes 
 			     * that would not be scheduled otherwise. */
 			    el.itr = min_itr + 1;
@@ -451,7 +384,7 @@ namespace graphchi {
 			}
 			out_edge->set_data(el);
 			
-			if (min_itr < K_HOPS) {
+			if (min_itr < KH) {
 			    /* Schedule the outgoing neighbor because
 			     * it needs to update its label too. */
 			    if (gcontext.scheduler != NULL)
@@ -459,7 +392,7 @@ namespace graphchi {
 			}
 		    }
 		    /* Now we decide if we want to schedule the node itself. */
-		    if (min_itr < K_HOPS + 1) {
+		    if (min_itr < KH + 1) {
 			/* Schedule itself because we haven't explore all hops yet. */
 			if (gcontext.scheduler != NULL)
 			    gcontext.scheduler->add_task(vertex.id());
@@ -468,6 +401,106 @@ namespace graphchi {
 	    }
 	}
 	
+	/* Relabel a vertex whose own label is @self, using its in-coming
+	 * @neighborhood (sorted by timestamp). The new label hashes the
+	 * vertex's own label followed by, for every neighbor, the edge
+	 * label (if @with_edges, i.e., in the first hop) and the neighbor's
+	 * label. The new label (or its chunks if CHUNKIFY) is then
+	 * inserted into the histogram. During streaming (@base is false),
+	 * we decay the histogram once before the insertion. */
+	unsigned long relabel(vid_t id, unsigned long self, std::vector<NeighborKey> &neighborhood,
+			      bool with_edges, bool base) {
+	    if (BINARY_RELABEL)
+		return this->relabel_binary(id, self, neighborhood, with_edges, base);
+	    return this->relabel_string(id, self, neighborhood, with_edges, base);
+	}
+
+	/* The original relabel: hash the labels as a space-separated
+	 * decimal string (see relabel()). The string is not built; the
+	 * label and its chunks are hashed as we go (StringLabelHasher). */
+	unsigned long relabel_string(vid_t id, unsigned long self, std::vector<NeighborKey> &neighborhood,
+				     bool with_edges, bool base) {
+	    /* Chunk hashes are collected into a per-thread buffer that
+	     * we reuse, so we do not allocate memory once it is large enough. */
+	    static thread_local std::vector<unsigned long> chunks;
+	    chunks.clear();
+	    StringLabelHasher hasher(CHUNKIFY ? CHUNK_SIZE : 0, CHUNKIFY ? &chunks : NULL);
+	    /* First the label of the vertex itself, then the neighborhood labels. */
+	    hasher.add(self);
+	    for (std::vector<NeighborKey>::iterator it = neighborhood.begin(); it != neighborhood.end(); ++it) {
+		if (with_edges)
+		    hasher.add(it->edg);
+		hasher.add(it->label);
+	    }
+	    hasher.finish();
+#ifdef DEBUG
+	    logstream(LOG_DEBUG) << "New label string of the vertex (" << id << "): " << hasher.string() << std::endl;
+#endif
+	    /* Relabel by hashing. */
+	    unsigned long new_label = hasher.value();
+#ifdef DEBUG
+	    logstream(LOG_DEBUG) << "New label of the vertex (" << id << "): " << new_label << std::endl;
+#endif
+	    /* Populate the histogram, depending if we CHUNKIFY or not. */
+	    if (!CHUNKIFY) {
+		if (!base)
+		    hist->decay(SFP);
+		hist->update(new_label, base);
+	    } else {
+		bool first = true;
+		for (std::vector<unsigned long>::iterator ti = chunks.begin(); ti != chunks.end(); ++ti) {
+		    if (first && !base)
+			hist->decay(SFP);  /* Only decay once. */
+		    first = false;
+		    hist->update(*ti, base);
+		}
+	    }
+	    return new_label;
+	}
+
+	/* The binary relabel: hash the sequence of 64-bit labels
+	 * directly (see relabel()), without building a string or
+	 * allocating memory. If CHUNKIFY, every CHUNK_SIZE labels
+	 * of the same sequence are hashed into one chunk, as the
+	 * string relabel does with the words of the string. */
+	unsigned long relabel_binary(vid_t id, unsigned long self, std::vector<NeighborKey> &neighborhood,
+				     bool with_edges, bool base) {
+	    LabelHasher label_hasher;
+	    LabelHasher chunk_hasher;
+	    bool first = true;
+	    /* Add one word to the label (and to the current chunk). */
+	    auto add = [&](unsigned long word) {
+		label_hasher.add(word);
+		if (!CHUNKIFY)
+		    return;
+		chunk_hasher.add(word);
+		if (chunk_hasher.count() == (unsigned long)CHUNK_SIZE) {
+		    if (first && !base)
+			hist->decay(SFP);  /* Only decay once. */
+		    first = false;
+		    hist->update(chunk_hasher.value(), base);
+		    chunk_hasher.reset();
+		}
+	    };
+	    add(self);
+	    for (std::vector<NeighborKey>::iterator it = neighborhood.begin(); it != neighborhood.end(); ++it) {
+		if (with_edges)
+		    add(it->edg);
+		add(it->label);
+	    }
+	    unsigned long new_label = label_hasher.value();
+#ifdef DEBUG
+	    logstream(LOG_DEBUG) << "New label of the vertex (" << id << "): " << new_label << std::endl;
+#endif
+	    /* Populate the histogram with the new label or the last chunk. */
+	    if (!CHUNKIFY || chunk_hasher.count() > 0) {
+		if (first && !base)
+		    hist->decay(SFP);
+		hist->update(CHUNKIFY ? chunk_hasher.value() : new_label, base);
+	    }
+	    return new_label;
+	}
+
 	/* Called before an iteration starts. */
 	void before_iteration(int iteration, graphchi_context &gcontext) {
 	}
@@ -477,25 +510,27 @@ namespace graphchi {
 #ifdef DEBUG
 	    logstream(LOG_DEBUG) << "Current iteration: " << iteration << std::endl;
 #endif
-	    if (iteration == K_HOPS)
-		std::base_graph_constructed = true;
-	    if (std::no_new_tasks){
+	    stream_coordinator* coordinator = stream_coordinator::get_instance();
+	    if (iteration == KH)
+		coordinator->set_base_graph_constructed();
+	    if (coordinator->has_no_new_tasks()){
 #ifdef DEBUG
 		logstream(LOG_DEBUG) << "No new task at the moment...Let's see if we need to stop or wait..." << std::endl;
 #endif
-		if (std::stop) {
+		/* The stream barrier does not wait once
+		 * the stream thread has set stop. */
+		if (!coordinator->wait_stream_barrier()) {
 #ifdef DEBUG
 		    logstream(LOG_DEBUG) << "Everything is done!" << std::endl;
 #endif
 		    gcontext.set_last_iteration(iteration); /* Set this iteration as the last one. */
 		    return;
 		}
-		pthread_barrier_wait(&std::stream_barrier);
-		std::no_new_tasks = false;
+		coordinator->set_no_new_tasks(false);
 #ifdef DEBUG
 		logstream(LOG_DEBUG) << "No new tasks to run! But we have new streaming edges..." << std::endl;
 #endif
-		pthread_barrier_wait(&std::graph_barrier);
+		coordinator->wait_graph_barrier();
 	    }
 	}
 